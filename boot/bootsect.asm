@@ -1,5 +1,6 @@
+; stage 1: checks for the int 0x13 extensions and loads stage2.asm, which loads the kernel
 [org 0x7c00]
-KERNEL_OFFSET equ 0x1000 ; The same one we used when linking the kernel
+%include "boot/layout.inc"
 
     mov [BOOT_DRIVE], dl ; Remember that the BIOS sets us the boot drive in 'dl' on boot
     mov bp, 0x9000
@@ -9,42 +10,44 @@ KERNEL_OFFSET equ 0x1000 ; The same one we used when linking the kernel
     call print
     call print_nl
 
-    call load_kernel ; read the kernel from disk
-    call switch_to_pm ; disable interrupts, load GDT,  etc. Finally jumps to 'BEGIN_PM'
+    call check_lba
+    call load_stage2
+    mov dl, [BOOT_DRIVE] ; stage 2 gets the drive the same way
+    jmp 0:STAGE2_OFFSET
     jmp $ ; Never executed
 
 %include "boot/print.asm"
 %include "boot/print_hex.asm"
 %include "boot/disk.asm"
-%include "boot/gdt.asm"
-%include "boot/32bit_print.asm"
-%include "boot/switch_pm.asm"
 
-[bits 16]
-load_kernel:
-    mov bx, MSG_LOAD_KERNEL
-    call print
-    call print_nl
-
-    mov bx, KERNEL_OFFSET ; Read from disk and store in 0x1000
-    mov dh, 47 ; Our future kernel will be larger, make this big
+check_lba:
+    mov ah, 0x41
+    mov bx, 0x55aa
     mov dl, [BOOT_DRIVE]
-    call disk_load
+    int 0x13
+    jc no_lba
+    cmp bx, 0xaa55
+    jne no_lba
+    test cx, 1 ; disk address packets supported
+    jz no_lba
     ret
 
-[bits 32]
-BEGIN_PM:
-    mov ebx, MSG_PROT_MODE
-    call print_string_pm
-    call KERNEL_OFFSET ; Give control to the kernel
-    jmp $ ; Stay here when the kernel returns control to us (if ever)
+no_lba:
+    mov bx, MSG_NO_LBA
+    call print
+    jmp $
+
+load_stage2:
+    mov word [dap_segment], STAGE2_OFFSET >> 4
+    mov dword [dap_lba], 1
+    mov cx, STAGE2_SECTORS
+    call disk_read
+    ret
 
 
 BOOT_DRIVE db 0 ; It is a good idea to store it in memory because 'dl' may get overwritten
 MSG_REAL_MODE db "Started in 16-bit Real Mode", 0
-MSG_PROT_MODE db "Landed in 32-bit Protected Mode", 0
-MSG_LOAD_KERNEL db "Loading kernel into memory", 0
-MSG_RETURNED_KERNEL db "Returned from kernel. Error?", 0
+MSG_NO_LBA db "No int 0x13 extensions", 0
 
 ; padding
 times 510 - ($-$$) db 0
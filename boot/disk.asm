@@ -1,28 +1,41 @@
-; load 'dh' sectors from drive 'dl' into ES:BX
-disk_load:
+; read cx sectors from lba [dap_lba] to [dap_segment]:0 with the int 0x13 extensions
+; (ah = 0x42, LBA instead of CHS). Each read is as large as BIOSes allow (127 sectors)
+; but stops at the next 64KiB boundary, so a read never crosses one
+disk_read:
     pusha
-    ; reading from disk requires setting specific values in all registers
-    ; so we will overwrite our input parameters from 'dx'. Let's save it
-    ; to the stack for later use.
-    push dx
-
-    mov ah, 0x02 ; ah <- int 0x13 function. 0x02 = 'read'
-    mov al, dh   ; al <- number of sectors to read (0x01 .. 0x80)
-    mov cl, 0x02 ; cl <- sector (0x01 .. 0x11)
-                 ; 0x01 is our boot sector, 0x02 is the first 'available' sector
-    mov ch, 0x00 ; ch <- cylinder (0x0 .. 0x3FF, upper 2 bits in 'cl')
-    ; dl <- drive number. Our caller sets it as a parameter and gets it from BIOS
-    ; (0 = floppy, 1 = floppy2, 0x80 = hdd, 0x81 = hdd2)
-    mov dh, 0x00 ; dh <- head number (0x0 .. 0xF)
-
-    ; [es:bx] <- pointer to buffer where the data will be stored
-    ; caller sets it up for us, and it is actually the standard location for int 13h
+
+disk_read_loop:
+    mov ax, [dap_segment]
+    and ax, 0x0fff
+    neg ax
+    add ax, 0x1000
+    shr ax, 5 ; sectors left before the next 64KiB boundary
+    cmp ax, 127
+    jbe disk_read_fit
+    mov ax, 127
+
+disk_read_fit:
+    cmp ax, cx
+    jbe disk_read_chunk
+    mov ax, cx
+
+disk_read_chunk:
+    mov [dap_count], ax
+    mov si, dap ; ds:si <- disk address packet
+    mov ah, 0x42
+    mov dl, [BOOT_DRIVE]
     int 0x13      ; BIOS interrupt
     jc disk_error ; if error (stored in the carry bit)
 
-    pop dx
-    cmp al, dh    ; BIOS also sets 'al' to the # of sectors read. Compare it.
-    jne sectors_error
+    mov ax, [dap_count]
+    add [dap_lba], ax
+    adc word [dap_lba + 2], 0
+    sub cx, ax
+    shl ax, 5 ; sectors * 512 / 16, the next chunk starts in a new segment
+    add [dap_segment], ax
+    cmp cx, 0
+    jne disk_read_loop
+
     popa
     ret
 
@@ -33,14 +46,21 @@ disk_error:
     call print_nl
     mov dh, ah ; ah = error code, dl = disk drive that dropped the error
     call print_hex ; check out the code at http://stanislavs.org/helppc/int_13-1.html
-    jmp disk_loop
-
-sectors_error:
-    mov bx, SECTORS_ERROR
-    call print
 
 disk_loop:
     jmp $
 
+; disk address packet for ah = 0x42
+dap:
+    db 0x10 ; packet size
+    db 0
+dap_count:
+    dw 0 ; sectors to read
+    dw 0 ; offset
+dap_segment:
+    dw 0
+dap_lba:
+    dd 0
+    dd 0
+
 DISK_ERROR: db "Disk read error", 0
-SECTORS_ERROR: db "Incorrect number of sectors read", 0
@@ -1,7 +1,45 @@
 global _start;
 [bits 32]
+MB_MAGIC equ 0x1badb002
+MB_FLAGS equ 0x3 ; modules page aligned, memory information wanted
 
 _start:
+    jmp entry ; stage2.asm calls the first byte
+
+; multiboot loaders look for this in the first 8KiB of the file (kernel-mb.elf in the Makefile)
+align 4
+multiboot_header:
+    dd MB_MAGIC
+    dd MB_FLAGS
+    dd -(MB_MAGIC + MB_FLAGS)
+
+entry:
     [extern kernel_main] ; Define calling point. Must have same name as kernel.c 'main' function
+    [extern __bss_start]
+    [extern _end]
+    ; a multiboot loader leaves its own GDT and no stack, both loaders end up with the ones from boot/
+    lgdt [gdt_descriptor]
+    jmp CODE_SEG:reload_segments
+reload_segments:
+    mov cx, DATA_SEG
+    mov ds, cx
+    mov ss, cx
+    mov es, cx
+    mov fs, cx
+    mov gs, cx
+    mov ebp, 0x90000
+    mov esp, ebp
+
+    mov edx, eax
+    mov edi, __bss_start ; the loader only reads kernel.bin, bss is whatever was in memory
+    mov ecx, _end
+    sub ecx, edi
+    xor eax, eax
+    cld
+    rep stosb
+    push ebx ; what the loader knows (kernel/boot.h)
+    push edx ; which loader it was
     call kernel_main ; Calls the C function. The linker will know where it is placed in memory
     jmp $
+
+%include "boot/gdt.asm"
@@ -0,0 +1,58 @@
+; stage 2: loads the kernel and switches to protected mode
+; the kernel's size comes from boot/kernel.inc, which the Makefile writes after linking kernel.bin
+[org 0x7e00]
+%include "boot/layout.inc"
+%include "boot/kernel.inc"
+
+[bits 16]
+    jmp stage2_start
+
+; handed to the kernel in ebx (kernel/boot.h), it copies it before anything can overwrite it
+align 4, db 0
+boot_info:
+    dd BOOT_MAGIC
+    dd 1 + STAGE2_SECTORS + KERNEL_SECTORS ; fs lba, the filesystem image follows the kernel
+    dd KERNEL_SECTORS
+BOOT_DRIVE:
+    dd 0
+    dd 0 ; end of memory, stage 2 doesn't look
+
+stage2_start:
+    mov [BOOT_DRIVE], dl
+
+    mov bx, MSG_LOAD_KERNEL
+    call print
+    call print_nl
+
+    ; the kernel no longer fits below the boot sector, so it goes to 0x10000
+    mov word [dap_segment], KERNEL_OFFSET >> 4
+    mov dword [dap_lba], 1 + STAGE2_SECTORS
+    mov cx, KERNEL_SECTORS
+    call disk_read
+
+    call switch_to_pm ; disable interrupts, load GDT,  etc. Finally jumps to 'BEGIN_PM'
+    jmp $ ; Never executed
+
+%include "boot/print.asm"
+%include "boot/print_hex.asm"
+%include "boot/disk.asm"
+%include "boot/gdt.asm"
+%include "boot/32bit_print.asm"
+%include "boot/switch_pm.asm"
+
+[bits 32]
+BEGIN_PM:
+    mov ebx, MSG_PROT_MODE
+    call print_string_pm
+    mov eax, BOOT_MAGIC
+    mov ebx, boot_info
+    call KERNEL_OFFSET ; Give control to the kernel
+    jmp $ ; Stay here when the kernel returns control to us (if ever)
+
+
+MSG_PROT_MODE db "Landed in 32-bit Protected Mode", 0
+MSG_LOAD_KERNEL db "Loading kernel into memory", 0
+MSG_RETURNED_KERNEL db "Returned from kernel. Error?", 0
+
+; padding, the kernel starts at the next sector
+times STAGE2_SECTORS * 512 - ($-$$) db 0
@@ -0,0 +1,63 @@
+#include "acpi.h"
+
+#define EBDA_SEGMENT 0x40E /* bios data area word with the segment of the EBDA */
+#define BIOS_AREA 0xE0000
+#define BIOS_AREA_END 0x100000
+
+typedef struct {
+    char signature[8]; /* "RSD PTR " */
+    uint8_t checksum; /* of these first 20 bytes */
+    char oem[6];
+    uint8_t revision;
+    uint32_t rsdt;
+} __attribute__((packed)) acpi_rsdp;
+
+static acpi_header *rsdt = 0;
+
+/* Every table sums to 0 */
+static int checksum(void *p, uint32_t len) {
+    uint8_t sum = 0;
+    for (uint32_t i = 0; i < len; i++) sum += ((uint8_t*)p)[i];
+    return sum == 0;
+}
+
+static int same(char *a, char *b, int n) {
+    for (int i = 0; i < n; i++) {
+        if (a[i] != b[i]) return 0;
+    }
+    return 1;
+}
+
+/* The RSDP sits on a 16 byte boundary */
+static acpi_rsdp *scan(uint32_t start, uint32_t end) {
+    for (uint32_t p = start; p + sizeof(acpi_rsdp) <= end; p += 16) {
+        acpi_rsdp *rsdp = (acpi_rsdp*)p;
+        if (same(rsdp->signature, "RSD PTR ", 8) && checksum(rsdp, sizeof(acpi_rsdp))) return rsdp;
+    }
+    return 0;
+}
+
+static acpi_header *find_rsdt() {
+    uint32_t ebda = (uint32_t)*(uint16_t*)EBDA_SEGMENT << 4;
+    acpi_rsdp *rsdp = ebda ? scan(ebda, ebda + 1024) : 0;
+    if (rsdp == 0) rsdp = scan(BIOS_AREA, BIOS_AREA_END);
+    if (rsdp == 0) return 0;
+
+    acpi_header *table = (acpi_header*)rsdp->rsdt;
+    if (!same(table->signature, "RSDT", 4) || !checksum(table, table->length)) return 0;
+    return table;
+}
+
+acpi_header *acpi_find(char signature[4]) {
+    if (rsdt == 0) rsdt = find_rsdt();
+    if (rsdt == 0) return 0;
+
+    /* 32 bit table addresses follow the header */
+    uint32_t *entries = (uint32_t*)(rsdt + 1);
+    uint32_t count = (rsdt->length - sizeof(acpi_header)) / 4;
+    for (uint32_t i = 0; i < count; i++) {
+        acpi_header *table = (acpi_header*)entries[i];
+        if (same(table->signature, signature, 4) && checksum(table, table->length)) return table;
+    }
+    return 0;
+}
@@ -0,0 +1,26 @@
+#ifndef ACPI_H
+#define ACPI_H
+
+#include <stdint.h>
+
+/* ACPI tables
+ * The firmware leaves a pointer (RSDP) in the first KiB of the EBDA or in
+ * the BIOS area at 0xE0000-0xFFFFF, it leads to the RSDT which lists every
+ * other table by physical address. Without paging they are read in place.
+ */
+typedef struct {
+    char signature[4];
+    uint32_t length; /* header included */
+    uint8_t revision;
+    uint8_t checksum;
+    char oem[6];
+    char oem_table[8];
+    uint32_t oem_revision;
+    uint32_t creator;
+    uint32_t creator_revision;
+} __attribute__((packed)) acpi_header;
+
+/* The first table with this signature whose checksum holds, 0x0 if there is none */
+acpi_header *acpi_find(char signature[4]);
+
+#endif
@@ -0,0 +1,188 @@
+#include "apic.h"
+#include "acpi.h"
+#include "cpuid.h"
+#include "isr.h"
+#include "ports.h"
+
+#define LAPIC_ID 0x20
+#define LAPIC_TPR 0x80
+#define LAPIC_EOI 0xB0
+#define LAPIC_SVR 0xF0
+#define LAPIC_SVR_ENABLE 0x100
+#define LAPIC_ICR_LOW 0x300
+#define LAPIC_ICR_HIGH 0x310 /* destination apic id in the top byte */
+#define LAPIC_ICR_PENDING (1 << 12)
+#define LAPIC_LVT_TIMER 0x320
+#define LAPIC_TIMER_INIT 0x380
+#define LAPIC_TIMER_CURRENT 0x390
+#define LAPIC_TIMER_DIVIDE 0x3E0
+#define LAPIC_DIVIDE_16 0x3
+#define LAPIC_MASKED (1 << 16)
+
+#define IOAPIC_SELECT 0x00
+#define IOAPIC_WINDOW 0x10
+#define IOAPIC_VERSION 0x01 /* bits 16-23 are the number of inputs - 1 */
+#define IOAPIC_REDIRECT 0x10 /* two registers per input, the high one holds the destination */
+#define IOAPIC_ACTIVE_LOW (1 << 13)
+#define IOAPIC_LEVEL (1 << 15)
+#define IOAPIC_MASKED (1 << 16)
+
+#define MSR_APIC_BASE 0x1B
+#define MSR_APIC_ENABLE (1 << 11)
+
+/* MADT entry types */
+#define MADT_LAPIC 0
+#define MADT_IOAPIC 1
+#define MADT_OVERRIDE 2
+#define MADT_LAPIC_ADDRESS 5
+
+/* Interrupt override flags, 0 means the bus default (ISA: active high, edge) */
+#define MPS_POLARITY 0x3
+#define MPS_ACTIVE_LOW 0x3
+#define MPS_TRIGGER 0xC
+#define MPS_LEVEL 0xC
+
+typedef struct {
+    acpi_header header;
+    uint32_t lapic;
+    uint32_t flags;
+} __attribute__((packed)) acpi_madt;
+
+static apic_info info;
+static int enabled = 0;
+
+static uint32_t lapic_read(uint32_t reg) {
+    return *(volatile uint32_t*)(info.lapic + reg);
+}
+
+static void lapic_write(uint32_t reg, uint32_t value) {
+    *(volatile uint32_t*)(info.lapic + reg) = value;
+}
+
+static uint32_t ioapic_read(uint8_t reg) {
+    *(volatile uint32_t*)(info.ioapic + IOAPIC_SELECT) = reg;
+    return *(volatile uint32_t*)(info.ioapic + IOAPIC_WINDOW);
+}
+
+static void ioapic_write(uint8_t reg, uint32_t value) {
+    *(volatile uint32_t*)(info.ioapic + IOAPIC_SELECT) = reg;
+    *(volatile uint32_t*)(info.ioapic + IOAPIC_WINDOW) = value;
+}
+
+/* Entries are a type byte, a length byte and the fields */
+static int parse_madt() {
+    acpi_madt *madt = (acpi_madt*)acpi_find("APIC");
+    if (madt == 0) return 0;
+
+    info.lapic = madt->lapic;
+    for (uint8_t irq = 0; irq < 16; irq++) info.isa_gsi[irq] = irq;
+
+    uint8_t *p = (uint8_t*)(madt + 1);
+    uint8_t *end = (uint8_t*)madt + madt->header.length;
+    for (; p + 2 <= end && p[1] >= 2; p += p[1]) {
+        switch (p[0]) {
+            case MADT_LAPIC: /* bit 0 of the flags: usable */
+                if ((*(uint32_t*)(p + 4) & 1) && info.cpus < APIC_MAX_CPUS) info.apic_ids[info.cpus++] = p[3];
+                break;
+            case MADT_IOAPIC:
+                if (*(uint32_t*)(p + 8) == 0) info.ioapic = *(uint32_t*)(p + 4);
+                break;
+            case MADT_OVERRIDE: /* bus 0 is ISA */
+                if (p[2] == 0 && p[3] < 16) {
+                    info.isa_gsi[p[3]] = *(uint32_t*)(p + 4);
+                    info.isa_flags[p[3]] = *(uint16_t*)(p + 8);
+                }
+                break;
+            case MADT_LAPIC_ADDRESS: /* 64 bit, only usable below 4GiB */
+                if (*(uint32_t*)(p + 8) == 0) info.lapic = *(uint32_t*)(p + 4);
+                break;
+        }
+    }
+    return info.lapic != 0 && info.ioapic != 0 && info.cpus != 0;
+}
+
+static void ioapic_route(uint8_t irq, uint8_t vector) {
+    uint32_t low = vector;
+    uint16_t flags = info.isa_flags[irq];
+    if ((flags & MPS_POLARITY) == MPS_ACTIVE_LOW) low |= IOAPIC_ACTIVE_LOW;
+    if ((flags & MPS_TRIGGER) == MPS_LEVEL) low |= IOAPIC_LEVEL;
+
+    uint8_t reg = IOAPIC_REDIRECT + info.isa_gsi[irq] * 2;
+    ioapic_write(reg + 1, (uint32_t)lapic_id() << 24);
+    ioapic_write(reg, low);
+}
+
+void lapic_enable() {
+    /* the firmware may have left it off */
+    wrmsr(MSR_APIC_BASE, rdmsr(MSR_APIC_BASE) | MSR_APIC_ENABLE);
+    lapic_write(LAPIC_TPR, 0);
+    lapic_write(LAPIC_SVR, LAPIC_SVR_ENABLE | IRQ_LAPIC_SPURIOUS);
+    lapic_write(LAPIC_TIMER_DIVIDE, LAPIC_DIVIDE_16);
+    lapic_write(LAPIC_LVT_TIMER, LAPIC_MASKED | IRQ_LAPIC_TIMER);
+}
+
+int init_apic() {
+    uint32_t a, b, c, d;
+    cpuid(1, &a, &b, &c, &d);
+    if (!(d & CPUID_EDX_APIC) || !(d & CPUID_EDX_MSR) || !parse_madt()) return 0;
+    lapic_enable();
+
+    /* the PIC stays remapped, anything it raised before the mask lands on an IRQ vector */
+    port_byte_out(0x21, 0xFF);
+    port_byte_out(0xA1, 0xFF);
+
+    /* IRQ2 is the cascade of the PICs, on the IOAPIC that input is usually the PIT's */
+    uint32_t inputs = ((ioapic_read(IOAPIC_VERSION) >> 16) & 0xFF) + 1;
+    for (uint8_t irq = 0; irq < 16; irq++) {
+        if (irq != 2 && info.isa_gsi[irq] < inputs) ioapic_route(irq, IRQ0 + irq);
+    }
+
+    enabled = 1;
+    return 1;
+}
+
+int apic_enabled() {
+    return enabled;
+}
+
+apic_info *apic_get_info() {
+    return &info;
+}
+
+uint8_t lapic_id() {
+    return lapic_read(LAPIC_ID) >> 24;
+}
+
+void lapic_eoi() {
+    lapic_write(LAPIC_EOI, 0);
+}
+
+void lapic_ipi(uint8_t apic_id, uint32_t command) {
+    lapic_write(LAPIC_ICR_HIGH, (uint32_t)apic_id << 24);
+    lapic_write(LAPIC_ICR_LOW, command);
+    while (lapic_read(LAPIC_ICR_LOW) & LAPIC_ICR_PENDING) asm volatile("pause");
+}
+
+void ioapic_mask(uint8_t irq, int masked) {
+    if (!enabled || irq >= 16) return;
+
+    uint32_t flags = irq_save();
+    uint8_t reg = IOAPIC_REDIRECT + info.isa_gsi[irq] * 2;
+    uint32_t low = ioapic_read(reg);
+    ioapic_write(reg, masked ? low | IOAPIC_MASKED : low & ~IOAPIC_MASKED);
+    irq_restore(flags);
+}
+
+void lapic_timer_start(uint32_t mode, uint32_t count) {
+    lapic_write(LAPIC_LVT_TIMER, IRQ_LAPIC_TIMER | mode);
+    lapic_write(LAPIC_TIMER_INIT, count);
+}
+
+void lapic_timer_stop() {
+    lapic_write(LAPIC_LVT_TIMER, LAPIC_MASKED | IRQ_LAPIC_TIMER);
+    lapic_write(LAPIC_TIMER_INIT, 0);
+}
+
+uint32_t lapic_timer_count() {
+    return lapic_read(LAPIC_TIMER_CURRENT);
+}
@@ -0,0 +1,50 @@
+#ifndef APIC_H
+#define APIC_H
+
+#include <stdint.h>
+
+/* Local APIC and IOAPIC
+ * When the cpu has an APIC and ACPI describes it (the MADT), the 8259 PICs
+ * are masked and the IOAPIC delivers the ISA interrupts instead, on the same
+ * vectors (IRQ0 + irq). Every cpu has a local APIC: it is acknowledged with
+ * a single store (lapic_eoi) and its timer can be the tick (cpu/timer.h).
+ * Without them the PIC stays in charge and apic_enabled() is 0.
+ *
+ * Only the IOAPIC that starts at GSI 0 is used, it covers the ISA interrupts.
+ */
+#define APIC_MAX_CPUS 16
+
+/* Interprocessor interrupts, all with the level assert bit */
+#define LAPIC_IPI_FIXED 0x4000 /* | vector */
+#define LAPIC_IPI_INIT 0x4500
+#define LAPIC_IPI_STARTUP 0x4600 /* | page the cpu starts at */
+
+#define LAPIC_TIMER_ONESHOT 0
+#define LAPIC_TIMER_PERIODIC (1 << 17)
+
+typedef struct {
+    uint8_t cpus; /* usable cpus, the boot cpu included */
+    uint8_t apic_ids[APIC_MAX_CPUS];
+    uint32_t lapic;
+    uint32_t ioapic;
+    uint8_t isa_gsi[16]; /* where every ISA irq arrives at the IOAPIC */
+    uint16_t isa_flags[16]; /* MPS polarity and trigger bits */
+} apic_info;
+
+int init_apic(); /* 1 if the APICs took over from the PIC, called after the PIC is remapped */
+int apic_enabled();
+apic_info *apic_get_info();
+
+void lapic_enable(); /* the calling cpu's, init_apic does the boot cpu's */
+uint8_t lapic_id();
+void lapic_eoi();
+void lapic_ipi(uint8_t apic_id, uint32_t command);
+
+void ioapic_mask(uint8_t irq, int masked); /* ISA irq */
+
+/* The timer counts down from count at the bus clock / 16 */
+void lapic_timer_start(uint32_t mode, uint32_t count);
+void lapic_timer_stop();
+uint32_t lapic_timer_count();
+
+#endif
@@ -0,0 +1,44 @@
+#ifndef CPUID_H
+#define CPUID_H
+
+#include <stdint.h>
+
+/* Feature bits of cpuid leaf 1 */
+#define CPUID_ECX_SSE42 (1 << 20)
+#define CPUID_EDX_FPU (1 << 0)
+#define CPUID_EDX_PSE (1 << 3)
+#define CPUID_EDX_TSC (1 << 4)
+#define CPUID_EDX_MSR (1 << 5)
+#define CPUID_EDX_APIC (1 << 9)
+#define CPUID_EDX_SEP (1 << 11)
+#define CPUID_EDX_FXSR (1 << 24)
+#define CPUID_EDX_SSE (1 << 25)
+#define CPUID_EDX_SSE2 (1 << 26)
+
+static inline void cpuid(uint32_t leaf, uint32_t *a, uint32_t *b, uint32_t *c, uint32_t *d) {
+    asm volatile("cpuid" : "=a" (*a), "=b" (*b), "=c" (*c), "=d" (*d) : "a" (leaf), "c" (0));
+}
+
+/* SYSENTER/SYSEXIT and the MSRs that set them up, the first pentium pros report SEP without having it */
+static inline int cpu_sysenter() {
+    uint32_t a, b, c, d;
+    cpuid(1, &a, &b, &c, &d);
+    if (!(d & CPUID_EDX_SEP) || !(d & CPUID_EDX_MSR)) return 0;
+
+    uint32_t family = (a >> 8) & 0xf;
+    uint32_t model = (a >> 4) & 0xf;
+    return !(family == 6 && model < 3 && (a & 0xf) < 3);
+}
+
+/* Model specific registers, check CPUID_EDX_MSR first */
+static inline uint64_t rdmsr(uint32_t msr) {
+    uint32_t low, high;
+    asm volatile("rdmsr" : "=a" (low), "=d" (high) : "c" (msr));
+    return ((uint64_t)high << 32) | low;
+}
+
+static inline void wrmsr(uint32_t msr, uint64_t value) {
+    asm volatile("wrmsr" : : "c" (msr), "a" ((uint32_t)value), "d" ((uint32_t)(value >> 32)));
+}
+
+#endif
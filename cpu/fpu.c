@@ -0,0 +1,110 @@
+#include "fpu.h"
+#include "cpuid.h"
+#include "../kernel/log.h"
+#include "../kernel/sched.h"
+
+#define CR0_MP (1 << 1)
+#define CR0_EM (1 << 2)
+#define CR0_TS (1 << 3)
+#define CR0_NE (1 << 5)
+#define CR4_OSFXSR (1 << 9)
+#define CR4_OSXMMEXCPT (1 << 10)
+
+#define MXCSR_DEFAULT 0x1F80 /* every exception masked, round to nearest */
+
+static uint32_t features = 0;
+static thread *owner = 0; /* whose registers the FPU holds */
+
+static inline uint32_t read_cr0() {
+    uint32_t cr0;
+    asm volatile("mov %%cr0, %0" : "=r" (cr0));
+    return cr0;
+}
+
+static inline void write_cr0(uint32_t cr0) {
+    asm volatile("mov %0, %%cr0" : : "r" (cr0) : "memory");
+}
+
+/* Fresh registers for a thread that never used the FPU */
+static void fpu_reset() {
+    asm volatile("fninit");
+    if (features & FPU_SSE) {
+        uint32_t mxcsr = MXCSR_DEFAULT;
+        asm volatile("ldmxcsr %0" : : "m" (mxcsr));
+    }
+}
+
+void fpu_enable() {
+    /* MP: wait/fwait honour TS too, NE: errors raise #MF instead of IRQ13 */
+    write_cr0((read_cr0() & ~(CR0_EM | CR0_TS)) | CR0_MP | CR0_NE);
+    if (features & FPU_FXSR) {
+        uint32_t cr4;
+        asm volatile("mov %%cr4, %0" : "=r" (cr4));
+        cr4 |= CR4_OSFXSR;
+        if (features & FPU_SSE) cr4 |= CR4_OSXMMEXCPT;
+        asm volatile("mov %0, %%cr4" : : "r" (cr4));
+    }
+    fpu_reset();
+}
+
+void init_fpu() {
+    uint32_t a, b, c, d;
+    cpuid(1, &a, &b, &c, &d);
+    if (d & CPUID_EDX_FPU) features |= FPU_X87;
+    if (d & CPUID_EDX_FXSR) features |= FPU_FXSR;
+    /* SSE needs FXSAVE to be saved */
+    if ((d & CPUID_EDX_SSE) && (features & FPU_FXSR)) features |= FPU_SSE;
+    if ((d & CPUID_EDX_SSE2) && (features & FPU_SSE)) features |= FPU_SSE2;
+
+    if (!(features & FPU_X87)) {
+        klog(LOG_WARN, "fpu: none\n");
+        features = 0;
+        return;
+    }
+
+    fpu_enable();
+    owner = 0;
+    write_cr0(read_cr0() | CR0_TS); /* the first user traps */
+    klog(LOG_INFO, "fpu: x87%s%s%s\n", features & FPU_FXSR ? " fxsr" : "",
+         features & FPU_SSE ? " sse" : "", features & FPU_SSE2 ? " sse2" : "");
+}
+
+uint32_t fpu_features() {
+    return features;
+}
+
+int fpu_trap() {
+    if (!features) return 0;
+
+    asm volatile("clts");
+    thread *t = thread_current();
+    if (owner == t) return 1;
+
+    if (owner != 0) {
+        if (features & FPU_FXSR) asm volatile("fxsave %0" : "=m" (owner->fpu));
+        else asm volatile("fnsave %0" : "=m" (owner->fpu));
+    }
+    if (!t->fpu_used) {
+        fpu_reset();
+        t->fpu_used = 1;
+    } else if (features & FPU_FXSR) {
+        asm volatile("fxrstor %0" : : "m" (t->fpu));
+    } else {
+        asm volatile("frstor %0" : : "m" (t->fpu));
+    }
+    owner = t;
+    return 1;
+}
+
+void fpu_switch(thread *next) {
+    if (!features) return;
+
+    /* writing cr0 is slow, only when TS changes */
+    uint32_t cr0 = read_cr0();
+    uint32_t want = next == owner ? cr0 & ~CR0_TS : cr0 | CR0_TS;
+    if (want != cr0) write_cr0(want);
+}
+
+void fpu_forget(thread *t) {
+    if (owner == t) owner = 0;
+}
@@ -0,0 +1,31 @@
+#ifndef FPU_H
+#define FPU_H
+
+#include <stdint.h>
+
+/* x87 and SSE
+ * Threads get the FPU lazily: switching to a thread that doesn't own it sets
+ * CR0.TS, so its first FPU or SSE instruction raises #NM (vector 7). Then
+ * fpu_trap saves the owner's registers in its thread and loads the current
+ * thread's, with FXSAVE when the cpu has it and FSAVE otherwise.
+ * Interrupt handlers must not use the FPU, they would clobber the registers
+ * of whichever thread they interrupted.
+ */
+#define FPU_STATE_SIZE 512 /* FXSAVE area, 16 byte aligned */
+
+#define FPU_X87 0x01
+#define FPU_FXSR 0x02
+#define FPU_SSE 0x04
+#define FPU_SSE2 0x08
+
+struct thread;
+
+void init_fpu(); /* the boot cpu, before the first thread switch */
+void fpu_enable(); /* the other cpus, they don't switch threads and keep it */
+uint32_t fpu_features();
+
+int fpu_trap(); /* #NM, 0 if it wasn't a lazy switch */
+void fpu_switch(struct thread *next); /* from the scheduler */
+void fpu_forget(struct thread *t); /* t is going away */
+
+#endif
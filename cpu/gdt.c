@@ -0,0 +1,61 @@
+#include "gdt.h"
+#include "apic.h"
+#include "idt.h"
+
+#define GDT_CODE 0x9A /* present, ring 0, executable, readable */
+#define GDT_DATA 0x92 /* present, ring 0, writable */
+#define GDT_USER_CODE 0xFA
+#define GDT_USER_DATA 0xF2
+#define GDT_TSS 0x89 /* present, 32 bit available TSS */
+#define GDT_FLAT 0xCF /* 4KiB granularity, 32 bit, limit 0xfffff */
+
+typedef struct {
+    uint16_t limit;
+    uint32_t base;
+} __attribute__((packed)) gdt_register;
+
+static gdt_entry gdts[APIC_MAX_CPUS][GDT_ENTRIES];
+static tss_entry tss[APIC_MAX_CPUS];
+
+static void gdt_set(gdt_entry *e, uint32_t base, uint32_t limit, uint8_t access, uint8_t flags) {
+    e->limit_low = limit & 0xFFFF;
+    e->base_low = base & 0xFFFF;
+    e->base_mid = (base >> 16) & 0xFF;
+    e->access = access;
+    e->flags_limit = (flags & 0xF0) | ((limit >> 16) & 0x0F);
+    e->base_high = (base >> 24) & 0xFF;
+}
+
+void gdt_install(uint8_t cpu) {
+    gdt_entry *gdt = gdts[cpu];
+    gdt_set(&gdt[0], 0, 0, 0, 0);
+    gdt_set(&gdt[KERNEL_CS / 8], 0, 0xFFFFF, GDT_CODE, GDT_FLAT);
+    gdt_set(&gdt[KERNEL_DS / 8], 0, 0xFFFFF, GDT_DATA, GDT_FLAT);
+    gdt_set(&gdt[USER_CS / 8], 0, 0xFFFFF, GDT_USER_CODE, GDT_FLAT);
+    gdt_set(&gdt[USER_DS / 8], 0, 0xFFFFF, GDT_USER_DATA, GDT_FLAT);
+
+    tss[cpu].ss0 = KERNEL_DS;
+    tss[cpu].iomap = sizeof(tss_entry);
+    gdt_set(&gdt[TSS_SEL / 8], (uint32_t)&tss[cpu], sizeof(tss_entry) - 1, GDT_TSS, 0);
+
+    gdt_register reg = { sizeof(gdts[0]) - 1, (uint32_t)gdt };
+    asm volatile("lgdt (%0)" : : "r" (&reg));
+
+    /* a far jump reloads cs */
+    asm volatile("ljmp %0, $1f\n1:\n"
+                 "mov %1, %%ds\n"
+                 "mov %1, %%es\n"
+                 "mov %1, %%fs\n"
+                 "mov %1, %%gs\n"
+                 "mov %1, %%ss\n"
+                 : : "i" (KERNEL_CS), "r" (KERNEL_DS) : "memory");
+    asm volatile("ltr %w0" : : "r" (TSS_SEL));
+}
+
+void tss_set_stack(uint8_t cpu, uint32_t esp0) {
+    tss[cpu].esp0 = esp0;
+}
+
+uint32_t *tss_stack(uint8_t cpu) {
+    return &tss[cpu].esp0;
+}
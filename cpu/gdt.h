@@ -0,0 +1,43 @@
+#ifndef GDT_H
+#define GDT_H
+
+#include <stdint.h>
+
+/* Every cpu gets its own GDT and TSS, the GDT boot/gdt.asm made is only
+ * used to get into protected mode. All segments are flat, the user ones
+ * only differ in privilege. SYSENTER needs them in exactly this order:
+ * kernel code, kernel data, user code, user data. */
+#define GDT_ENTRIES 6
+#define KERNEL_DS 0x10
+#define USER_CS 0x1B /* 0x18 | ring 3 */
+#define USER_DS 0x23 /* 0x20 | ring 3 */
+#define TSS_SEL 0x28
+
+typedef struct {
+    uint16_t limit_low;
+    uint16_t base_low;
+    uint8_t base_mid;
+    uint8_t access;
+    uint8_t flags_limit; /* flags in the high 4 bits */
+    uint8_t base_high;
+} __attribute__((packed)) gdt_entry;
+
+/* Only the ring 0 stack fields are used, the cpu switches to esp0 when
+ * ring 3 is interrupted. Every field is naturally aligned, so it needs no
+ * packing and &esp0 is a proper pointer for SYSENTER */
+typedef struct {
+    uint32_t prev;
+    uint32_t esp0;
+    uint32_t ss0;
+    uint32_t unused[22];
+    uint16_t trap;
+    uint16_t iomap; /* past the limit, no io ports for ring 3 */
+} tss_entry;
+
+_Static_assert(sizeof(tss_entry) == 104, "the cpu expects a 104 byte TSS");
+
+void gdt_install(uint8_t cpu); /* loads the cpu's tables and reloads the segment registers */
+void tss_set_stack(uint8_t cpu, uint32_t esp0);
+uint32_t *tss_stack(uint8_t cpu); /* the esp0 field, SYSENTER loads esp from it */
+
+#endif
@@ -9,6 +9,12 @@ void set_idt_gate(int n, uint32_t handler) {
     idt[n].high_offset = high_16(handler);
 }
 
+/* A trap gate ring 3 can use with int, interrupts stay on */
+void set_idt_user_gate(int n, uint32_t handler) {
+    set_idt_gate(n, handler);
+    idt[n].flags = 0xEF;
+}
+
 void set_idt() {
     idt_reg.base = (uint32_t) &idt;
     idt_reg.limit = IDT_ENTRIES * sizeof(idt_gate_t) - 1;
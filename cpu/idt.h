@@ -34,6 +34,7 @@ idt_register_t idt_reg;
 
 /* Functions implemented in idt.c */
 void set_idt_gate(int n, uint32_t handler);
+void set_idt_user_gate(int n, uint32_t handler);
 void set_idt();
 
 #endif
@@ -1,6 +1,7 @@
 ; Defined in isr.c
 [extern isr_handler]
 [extern irq_handler]
+[extern syscall_dispatch]
 
 ; Common ISR code
 isr_common_stub:
@@ -29,8 +30,9 @@ isr_common_stub:
 	add esp, 8 ; Cleans up the pushed error code and pushed ISR number
 	iret ; pops 5 things at once: CS, EIP, EFLAGS, SS, and ESP
 
-; Common IRQ code. Identical to ISR code except for the 'call' 
-; and the 'pop ebx'
+; Common IRQ code. Identical to ISR code except for the 'call'
+; and the stack switch: irq_handler returns the registers_t to resume,
+; which belongs to another thread after a context switch (kernel/sched.h)
 irq_common_stub:
     pusha 
     mov ax, ds
@@ -43,7 +45,7 @@ irq_common_stub:
     push esp
     cld
     call irq_handler ; Different than the ISR code
-    pop ebx  ; Different than the ISR code
+    mov esp, eax ; Different than the ISR code, drops the argument too
     pop ebx
     mov ds, bx
     mov es, bx
@@ -110,6 +112,12 @@ global irq12
 global irq13
 global irq14
 global irq15
+global irq_yield
+global irq_lapic_timer
+global irq_lapic_spurious
+global irq_smp_wake
+global isr_syscall
+global sysenter_entry
 
 ; 0: Divide By Zero Exception
 isr0:
@@ -378,3 +386,51 @@ irq15:
 	push byte 47
 	jmp irq_common_stub
 
+; 48: thread_yield, goes through the IRQ path so the scheduler can switch
+irq_yield:
+	push byte 0
+	push byte 48
+	jmp irq_common_stub
+
+; 49: local APIC timer, the tick when there is an APIC
+irq_lapic_timer:
+	push byte 0
+	push byte 49
+	jmp irq_common_stub
+
+; 63: local APIC spurious interrupt
+irq_lapic_spurious:
+	push byte 0
+	push byte 63
+	jmp irq_common_stub
+
+; 50: wakes a halted application processor, cpu/smp.c acknowledges it
+irq_smp_wake:
+	iret
+
+; 128: int 0x80 from ring 3, isr_handler passes it on to syscall_handler
+isr_syscall:
+	push byte 0
+	push dword 128
+	jmp isr_common_stub
+
+; SYSENTER lands here with interrupts off and esp pointing at the esp0 of the
+; TSS. The caller put its esp in ecx and where to return in edx, the number in
+; eax and the arguments in ebx, esi and edi (kernel/syscall.h). ds and es keep
+; the user segments, they are as flat as the kernel's.
+sysenter_entry:
+	mov esp, [esp] ; the thread's kernel stack
+	push ecx
+	push edx
+	sti
+	cld
+	push edi
+	push esi
+	push ebx
+	push eax
+	call syscall_dispatch ; the result stays in eax
+	add esp, 16
+	pop edx
+	pop ecx
+	sti ; in case the call left them off, sysexit keeps eflags
+	sysexit
@@ -1,12 +1,38 @@
 #include "isr.h"
 #include "idt.h"
+#include "apic.h"
+#include "fpu.h"
+#include "spinlock.h"
 #include "../drivers/screen.h"
 #include "../drivers/keyboard.h"
+#include "../drivers/serial.h"
+#include "../kernel/log.h"
+#include "../kernel/sched.h"
+#include "../kernel/syscall.h"
+#include "../kernel/vm.h"
+#include "../libc/mem.h"
 #include "../libc/string.h"
 #include "timer.h"
 #include "ports.h"
 
+#define PIC1 0x20
+#define PIC2 0xA0
+#define PIC_EOI 0x20
+#define PIC_READ_ISR 0x0B
+
 isr_t interrupt_handlers[256];
+static spinlock handlers_lock = SPINLOCK_INIT; /* writers only, irq_handler loads one pointer */
+
+/* Accounting for IRQ0 to IRQ_LAPIC_SPURIOUS, the cycles are spent in the handler itself */
+typedef struct {
+    uint32_t count;
+    uint32_t spurious;
+    uint64_t cycles;
+    uint32_t max_cycles;
+} irq_stat;
+
+#define IRQ_STATS (IRQ_LAPIC_SPURIOUS - IRQ0 + 1)
+static irq_stat irq_stats[IRQ_STATS];
 
 /* Can't do this with a loop because we need the address
  * of the function names */
@@ -73,6 +99,10 @@ void isr_install() {
     set_idt_gate(45, (uint32_t)irq13);
     set_idt_gate(46, (uint32_t)irq14);
     set_idt_gate(47, (uint32_t)irq15);
+    set_idt_gate(IRQ_YIELD, (uint32_t)irq_yield);
+    set_idt_gate(IRQ_LAPIC_TIMER, (uint32_t)irq_lapic_timer);
+    set_idt_gate(IRQ_LAPIC_SPURIOUS, (uint32_t)irq_lapic_spurious);
+    set_idt_gate(IRQ_SMP_WAKE, (uint32_t)irq_smp_wake);
 
     set_idt(); // Load with ASM
 }
@@ -116,38 +146,125 @@ char *exception_messages[] = {
     "Reserved"
 };
 
+/* A system call touching a bad page of its program counts as the program's fault */
+static int user_fault(registers_t *r) {
+    if ((r->cs & 3) == 3) return 1;
+    if (r->int_no != 14) return 0;
+
+    thread *t = thread_current();
+    uint32_t addr = read_cr2();
+    return t != 0 && t->vm != 0 && addr >= USER_BASE && addr < USER_END;
+}
+
 void isr_handler(registers_t *r) {
-    kprint("received interrupt: ");
-    char s[3];
-    int_to_ascii(r->int_no, s);
-    kprint(s);
-    kprint("\n");
-    kprint(exception_messages[r->int_no]);
-    kprint("\n");
+    if (r->int_no == IRQ_SYSCALL) {
+        syscall_handler(r);
+        return;
+    }
+    /* No Coprocessor: the FPU is switched lazily */
+    if (r->int_no == 7 && fpu_trap()) return;
+    /* Page Fault: programs are paged in on demand */
+    if (r->int_no == 14 && vm_fault(r)) return;
+
+    /* A fault in ring 3 only ends that thread */
+    if (user_fault(r)) {
+        klog(LOG_ERR, "thread %u killed: %s at 0x%x\n", thread_current()->id, exception_messages[r->int_no], r->eip);
+        thread_exit();
+    }
+
+    klog(LOG_ERR, "received interrupt: %u\n%s\n", r->int_no, exception_messages[r->int_no]);
+    log_drain(); /* klogd may never run again after a fault */
 }
 
 void register_interrupt_handler(uint8_t n, isr_t handler) {
+    uint32_t flags = spin_lock_irqsave(&handlers_lock);
     interrupt_handlers[n] = handler;
+    spin_unlock_irqrestore(&handlers_lock, flags);
 }
 
-void irq_handler(registers_t *r) {
-    /* After every interrupt we need to send an EOI to the PICs
-     * or they will not send another interrupt again */
-    if (r->int_no >= 40) port_byte_out(0xA0, 0x20); /* slave */
-    port_byte_out(0x20, 0x20); /* master */
+/* The lowest priority line of a PIC also fires when a request goes away
+ * before it is acknowledged. Then its in-service bit is clear, and it needs
+ * no EOI (but a spurious IRQ15 did go through the master's IRQ2) */
+static int irq_spurious(uint32_t int_no) {
+    if (int_no == IRQ_LAPIC_SPURIOUS) return 1; /* never acknowledged either */
+    if (apic_enabled()) return 0; /* the PIC is masked, the IOAPIC only sends real ones */
+
+    uint16_t pic;
+    if (int_no == IRQ7) pic = PIC1;
+    else if (int_no == IRQ15) pic = PIC2;
+    else return 0;
+
+    port_byte_out(pic, PIC_READ_ISR);
+    if (port_byte_in(pic) & 0x80) return 0;
+
+    if (int_no == IRQ15) port_byte_out(PIC1, PIC_EOI);
+    return 1;
+}
+
+/* Returns the registers interrupt.asm resumes, another thread's if the scheduler switched */
+registers_t *irq_handler(registers_t *r) {
+    timer_irq_enter();
+
+    irq_stat *stat = &irq_stats[r->int_no - IRQ0];
+    if (irq_spurious(r->int_no)) {
+        stat->spurious++;
+        return schedule(r);
+    }
+
+    /* After every interrupt we need to send an EOI to the PICs (or the
+     * local APIC) or they will not send another interrupt again */
+    if (apic_enabled()) {
+        if (r->int_no != IRQ_YIELD) lapic_eoi();
+    } else if (r->int_no <= IRQ15) {
+        if (r->int_no >= IRQ8) port_byte_out(PIC2, PIC_EOI); /* slave */
+        port_byte_out(PIC1, PIC_EOI); /* master */
+    }
 
     /* Handle the interrupt in a more modular way */
+    stat->count++;
     if (interrupt_handlers[r->int_no] != 0) {
         isr_t handler = interrupt_handlers[r->int_no];
+        uint64_t start = rdtsc();
         handler(r);
+        uint32_t cycles = rdtsc() - start;
+        stat->cycles += cycles;
+        if (cycles > stat->max_cycles) stat->max_cycles = cycles;
+    }
+    return schedule(r);
+}
+
+void irq_stats_reset() {
+    uint32_t flags = irq_save();
+    memset(irq_stats, 0, sizeof(irq_stats));
+    irq_restore(flags);
+}
+
+void print_irq_stats() {
+    kprintf("irq      count spurious   avg_ns   max_ns\n");
+    for (int i = 0; i < IRQ_STATS; i++) {
+        uint32_t flags = irq_save();
+        irq_stat stat = irq_stats[i];
+        irq_restore(flags);
+        if (stat.count == 0 && stat.spurious == 0) continue;
+
+        uint32_t avg = stat.count ? div64_32(stat.cycles, stat.count) : 0;
+        if (i + IRQ0 == IRQ_YIELD) kprintf("yield");
+        else if (i + IRQ0 == IRQ_LAPIC_TIMER) kprintf("lapic");
+        else if (i + IRQ0 == IRQ_LAPIC_SPURIOUS) kprintf("spur ");
+        else kprintf("%5d", i);
+        kprintf(" %10u %8u %8llu %8llu\n", stat.count, stat.spurious, cycles_to_ns(avg), cycles_to_ns(stat.max_cycles));
     }
 }
 
 void irq_install() {
+    /* The IOAPIC takes over from the PIC when there is one */
+    init_apic();
     /* Enable interruptions */
     asm volatile("sti");
     /* IRQ0: timer */
-    init_timer(50);
+    init_timer();
     /* IRQ1: keyboard */
     init_keyboard();
+    /* IRQ4: COM1 */
+    init_serial();
 }
@@ -53,6 +53,10 @@ extern void irq12();
 extern void irq13();
 extern void irq14();
 extern void irq15();
+extern void irq_yield();
+extern void irq_lapic_timer();
+extern void irq_lapic_spurious();
+extern void irq_smp_wake();
 
 #define IRQ0 32
 #define IRQ1 33
@@ -70,6 +74,11 @@ extern void irq15();
 #define IRQ13 45
 #define IRQ14 46
 #define IRQ15 47
+#define IRQ_YIELD 48 /* software interrupt, not from the PIC */
+#define IRQ_LAPIC_TIMER 49 /* local APIC timer (cpu/apic.h) */
+#define IRQ_SMP_WAKE 50 /* only taken by the other cpus (cpu/smp.h) */
+#define IRQ_LAPIC_SPURIOUS 63 /* the low 4 bits have to be set on older cpus */
+#define IRQ_SYSCALL 128 /* int 0x80 from ring 3 (kernel/syscall.h) */
 
 /* Struct which aggregates many registers.
  * It matches exactly the pushes on interrupt.asm. From the bottom:
@@ -87,9 +96,25 @@ typedef struct {
 
 void isr_install();
 void isr_handler(registers_t *r);
+registers_t *irq_handler(registers_t *r);
 void irq_install();
 
+/* Per interrupt counts and handler times for the irqstat command */
+void print_irq_stats();
+void irq_stats_reset();
+
 typedef void (*isr_t)(registers_t*);
 void register_interrupt_handler(uint8_t n, isr_t handler);
 
+/* Disables interrupts and returns the old eflags, irq_restore turns them back on only if they were */
+static inline uint32_t irq_save() {
+    uint32_t flags;
+    asm volatile("pushf; pop %0; cli" : "=r" (flags) : : "memory");
+    return flags;
+}
+
+static inline void irq_restore(uint32_t flags) {
+    if (flags & 0x200) asm volatile("sti" : : : "memory");
+}
+
 #endif
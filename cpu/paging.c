@@ -0,0 +1,157 @@
+#include "paging.h"
+#include "cpuid.h"
+#include "spinlock.h"
+#include "../libc/mem.h"
+
+#define PDE_PRESENT 0x001
+#define PDE_WRITE 0x002
+#define PDE_USER 0x004
+#define PDE_NOCACHE 0x018 /* write through and cache disable */
+#define PDE_LARGE 0x080 /* 4MiB page */
+
+#define CR0_PG 0x80000000
+#define CR0_WP 0x10000 /* read only pages hold in ring 0 too, system calls can't write a program's text */
+#define CR4_PSE (1 << 4)
+
+#define FRAMES ((FRAME_END - FRAME_BASE) / PAGE_SIZE)
+#define MMIO_PDE (0xFEC00000 >> 22) /* the IOAPIC and the local APIC */
+
+static uint32_t kernel_pd[1024] __attribute__((aligned(PAGE_SIZE)));
+static uint32_t frame_map[FRAMES / 32]; /* a set bit is a used frame */
+static uint32_t frames_left = FRAMES;
+static uint32_t next_frame = 0; /* where the search starts */
+static spinlock frame_lock = SPINLOCK_INIT;
+static int enabled = 0;
+
+int init_paging() {
+    uint32_t a, b, c, d;
+    cpuid(1, &a, &b, &c, &d);
+    if (!(d & CPUID_EDX_PSE)) return 0;
+
+    /* supervisor only, ring 3 reaches nothing but the user window */
+    for (uint32_t i = 0; i < 1024; i++) {
+        uint32_t addr = i << 22;
+        if (addr >= USER_BASE && addr < USER_END) continue;
+        kernel_pd[i] = addr | PDE_PRESENT | PDE_WRITE | PDE_LARGE;
+    }
+    kernel_pd[MMIO_PDE] |= PDE_NOCACHE;
+
+    uint32_t cr4;
+    asm volatile("mov %%cr4, %0" : "=r" (cr4));
+    asm volatile("mov %0, %%cr4" : : "r" (cr4 | CR4_PSE));
+    asm volatile("mov %0, %%cr3" : : "r" (kernel_pd));
+
+    uint32_t cr0;
+    asm volatile("mov %%cr0, %0" : "=r" (cr0));
+    asm volatile("mov %0, %%cr0" : : "r" (cr0 | CR0_PG | CR0_WP) : "memory");
+    enabled = 1;
+    return 1;
+}
+
+int paging_enabled() {
+    return enabled;
+}
+
+void init_frames(uint32_t mem_end) {
+    if (mem_end == 0 || mem_end >= FRAME_END) return;
+
+    /* the frames past the end of memory are never free */
+    uint32_t first = mem_end <= FRAME_BASE ? 0 : (mem_end - FRAME_BASE) / PAGE_SIZE;
+    for (uint32_t i = first; i < FRAMES; i++) frame_map[i / 32] |= 1u << (i % 32);
+    frames_left = first;
+}
+
+uint32_t frame_alloc() {
+    uint32_t flags = spin_lock_irqsave(&frame_lock);
+    uint32_t frame = 0;
+    for (uint32_t n = 0; n < FRAMES && frames_left != 0; n++) {
+        uint32_t i = (next_frame + n) % FRAMES;
+        if (frame_map[i / 32] & (1u << (i % 32))) continue;
+
+        frame_map[i / 32] |= 1u << (i % 32);
+        frames_left--;
+        next_frame = i + 1;
+        frame = FRAME_BASE + i * PAGE_SIZE;
+        break;
+    }
+    spin_unlock_irqrestore(&frame_lock, flags);
+
+    if (frame != 0) memset((void*)frame, 0, PAGE_SIZE);
+    return frame;
+}
+
+void frame_free(uint32_t frame) {
+    if (frame < FRAME_BASE || frame >= FRAME_END) return;
+
+    uint32_t i = (frame - FRAME_BASE) / PAGE_SIZE;
+    uint32_t flags = spin_lock_irqsave(&frame_lock);
+    if (frame_map[i / 32] & (1u << (i % 32))) {
+        frame_map[i / 32] &= ~(1u << (i % 32));
+        frames_left++;
+    }
+    spin_unlock_irqrestore(&frame_lock, flags);
+}
+
+uint32_t frames_free() {
+    return frames_left;
+}
+
+uint32_t pd_create() {
+    uint32_t *pd = (uint32_t*)frame_alloc();
+    if (pd == 0) return 0;
+
+    /* the kernel's mappings are supervisor only, programs can't touch them */
+    for (uint32_t i = 0; i < 1024; i++) pd[i] = kernel_pd[i];
+    return (uint32_t)pd;
+}
+
+void pd_destroy(uint32_t pd) {
+    uint32_t *dir = (uint32_t*)pd;
+    for (uint32_t i = USER_BASE >> 22; i < USER_END >> 22; i++) {
+        if (dir[i] & PDE_PRESENT) frame_free(dir[i] & PAGE_MASK);
+    }
+    frame_free(pd);
+}
+
+void paging_switch(uint32_t pd) {
+    if (!enabled) return;
+    if (pd == 0) pd = (uint32_t)kernel_pd;
+
+    uint32_t cr3;
+    asm volatile("mov %%cr3, %0" : "=r" (cr3));
+    if (cr3 != pd) asm volatile("mov %0, %%cr3" : : "r" (pd) : "memory");
+}
+
+int page_map(uint32_t pd, uint32_t vaddr, uint32_t frame, uint32_t flags) {
+    uint32_t *dir = (uint32_t*)pd;
+    uint32_t *pde = &dir[vaddr >> 22];
+    if (!(*pde & PDE_PRESENT)) {
+        uint32_t table = frame_alloc();
+        if (table == 0) return 0;
+        /* the ptes decide about writing */
+        *pde = table | PDE_PRESENT | PDE_WRITE | PDE_USER;
+    }
+
+    uint32_t *table = (uint32_t*)(*pde & PAGE_MASK);
+    table[(vaddr >> 12) & 0x3FF] = (frame & PAGE_MASK) | flags | PTE_PRESENT;
+    asm volatile("invlpg (%0)" : : "r" (vaddr) : "memory");
+    return 1;
+}
+
+uint32_t page_entry(uint32_t pd, uint32_t vaddr) {
+    uint32_t pde = ((uint32_t*)pd)[vaddr >> 22];
+    if (!(pde & PDE_PRESENT) || (pde & PDE_LARGE)) return 0;
+    return ((uint32_t*)(pde & PAGE_MASK))[(vaddr >> 12) & 0x3FF];
+}
+
+void pd_walk(uint32_t pd, void (*fn)(uint32_t vaddr, uint32_t pte, void *arg), void *arg) {
+    uint32_t *dir = (uint32_t*)pd;
+    for (uint32_t i = USER_BASE >> 22; i < USER_END >> 22; i++) {
+        if (!(dir[i] & PDE_PRESENT)) continue;
+
+        uint32_t *table = (uint32_t*)(dir[i] & PAGE_MASK);
+        for (uint32_t j = 0; j < 1024; j++) {
+            if (table[j] & PTE_PRESENT) fn((i << 22) | (j << 12), table[j], arg);
+        }
+    }
+}
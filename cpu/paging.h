@@ -0,0 +1,58 @@
+#ifndef PAGING_H
+#define PAGING_H
+
+#include <stdint.h>
+
+/* Paging
+ * The kernel page directory maps all 4GiB onto itself with 4MiB pages, so
+ * turning paging on changes no address the kernel uses. Only the user window
+ * [USER_BASE, USER_END) is left out: every program gets a page directory of
+ * its own (pd_create) with the same identity part, but supervisor only, and
+ * 4KiB pages in the window that kernel/vm.c fills in on page faults.
+ *
+ * Physical pages (frames) for page tables and program memory come from a
+ * bitmap over [FRAME_BASE, FRAME_END), above everything the heap should need.
+ * When the loader knows where memory ends (kernel/boot.h) init_frames cuts
+ * the range short, otherwise the machine is assumed to have FRAME_END.
+ * The other cpus don't turn paging on, they see the same identity addresses.
+ */
+#define PAGE_SIZE 4096
+#define PAGE_MASK (~(PAGE_SIZE - 1))
+
+#define USER_BASE 0x40000000
+#define USER_END 0x80000000
+
+#define FRAME_BASE 0x1000000 /* 16MiB */
+#define FRAME_END 0x4000000 /* 64MiB, the smallest machine this expects */
+
+#define PTE_PRESENT 0x001
+#define PTE_WRITE 0x002
+#define PTE_USER 0x004
+#define PTE_SHARED 0x200 /* available bit: the frame isn't the program's own */
+
+int init_paging(); /* 0 without 4MiB pages (CPUID PSE), then there is no user window */
+int paging_enabled();
+
+void init_frames(uint32_t mem_end); /* before the first frame_alloc, 0 keeps FRAME_END */
+uint32_t frame_alloc(); /* zeroed, 0 when they are gone */
+void frame_free(uint32_t frame);
+uint32_t frames_free();
+
+uint32_t pd_create(); /* 0 if there is no frame for it */
+void pd_destroy(uint32_t pd); /* frees the page tables and the directory, not the pages */
+void paging_switch(uint32_t pd); /* 0 is the kernel directory */
+
+/* Maps a page of the user window, 0 if a page table couldn't be allocated */
+int page_map(uint32_t pd, uint32_t vaddr, uint32_t frame, uint32_t flags);
+uint32_t page_entry(uint32_t pd, uint32_t vaddr); /* the pte, 0 if it isn't mapped */
+
+/* Calls fn for every mapped page of the user window */
+void pd_walk(uint32_t pd, void (*fn)(uint32_t vaddr, uint32_t pte, void *arg), void *arg);
+
+static inline uint32_t read_cr2() {
+    uint32_t cr2;
+    asm volatile("mov %%cr2, %0" : "=r" (cr2));
+    return cr2;
+}
+
+#endif
@@ -0,0 +1,172 @@
+#include "smp.h"
+#include "apic.h"
+#include "fpu.h"
+#include "gdt.h"
+#include "idt.h"
+#include "isr.h"
+#include "timer.h"
+#include "../drivers/screen.h"
+#include "../kernel/log.h"
+#include "../kernel/sched.h"
+#include "../libc/mem.h"
+
+extern char trampoline_start[];
+extern char trampoline_end[];
+extern char trampoline_stack[];
+extern char trampoline_entry[];
+
+#define TRAMPOLINE_VAR(var) (*(uint32_t*)(TRAMPOLINE + (var - trampoline_start)))
+
+static cpu_info cpus[APIC_MAX_CPUS];
+static uint8_t cpu_index[256]; /* by apic id */
+static uint8_t online = 1;
+static volatile uint8_t booting = 0; /* the cpu being started, they go one at a time */
+static mutex smp_lock;
+
+/* The other cpus only take the wake IPI, every other vector is ignored */
+static idt_gate_t ap_idt[IDT_ENTRIES];
+static idt_register_t ap_idt_reg;
+
+static void ap_main() {
+    cpu_info *cpu = &cpus[booting];
+    gdt_install(cpu->id);
+    asm volatile("lidtl (%0)" : : "r" (&ap_idt_reg));
+    lapic_enable();
+    if (fpu_features()) fpu_enable();
+    cpu->online = 1;
+
+    for (;;) {
+        if (cpu->work != 0) {
+            cpu->work(cpu->part, cpu->parts, cpu->arg);
+            __atomic_store_n(&cpu->work, 0, __ATOMIC_RELEASE);
+        }
+        /* a wake IPI sent before the hlt is taken right after the sti */
+        asm volatile("sti; hlt; cli" : : : "memory");
+        lapic_eoi();
+    }
+}
+
+static int start_ap(cpu_info *cpu) {
+    lapic_ipi(cpu->apic_id, LAPIC_IPI_INIT);
+    delay_us(10000);
+    for (int sipi = 0; sipi < 2 && !cpu->online; sipi++) {
+        lapic_ipi(cpu->apic_id, LAPIC_IPI_STARTUP | (TRAMPOLINE >> 12));
+        delay_us(200);
+    }
+    for (uint32_t ms = 0; ms < AP_START_MS && !cpu->online; ms++) delay_us(1000);
+    return cpu->online;
+}
+
+void init_smp() {
+    gdt_install(0);
+    cpus[0].online = 1;
+    if (!apic_enabled()) return;
+
+    apic_info *info = apic_get_info();
+    uint8_t bsp = lapic_id();
+    cpus[0].apic_id = bsp;
+    cpu_index[bsp] = 0;
+
+    memcpy(idt, ap_idt, sizeof(ap_idt));
+    for (int i = IRQ0; i < IDT_ENTRIES; i++) ap_idt[i] = idt[IRQ_SMP_WAKE];
+    ap_idt_reg.base = (uint32_t)&ap_idt;
+    ap_idt_reg.limit = sizeof(ap_idt) - 1;
+
+    memcpy(trampoline_start, (void*)TRAMPOLINE, trampoline_end - trampoline_start);
+    TRAMPOLINE_VAR(trampoline_entry) = (uint32_t)ap_main;
+
+    for (uint8_t i = 0; i < info->cpus; i++) {
+        if (info->apic_ids[i] == bsp) continue;
+
+        cpu_info *cpu = &cpus[online];
+        cpu->id = online;
+        cpu->apic_id = info->apic_ids[i];
+        cpu->stack = kmalloc(AP_STACK_SIZE);
+        if (cpu->stack == 0) break;
+
+        TRAMPOLINE_VAR(trampoline_stack) = (uint32_t)(cpu->stack + AP_STACK_SIZE);
+        booting = online;
+        if (start_ap(cpu)) {
+            cpu_index[cpu->apic_id] = online;
+            online++;
+        } else {
+            klog(LOG_WARN, "smp: cpu with apic id %u didn't start\n", cpu->apic_id);
+            kfree(cpu->stack);
+            cpu->stack = 0;
+        }
+    }
+    klog(LOG_INFO, "smp: %u cpus online\n", online);
+}
+
+uint8_t smp_cpus() {
+    return online;
+}
+
+uint8_t smp_cpu() {
+    return apic_enabled() ? cpu_index[lapic_id()] : 0;
+}
+
+void smp_run(smp_fn fn, void *arg, uint32_t parts) {
+    if (parts == 0 || parts > online) parts = online;
+
+    mutex_lock(&smp_lock);
+    for (uint32_t i = 1; i < parts; i++) {
+        cpus[i].part = i;
+        cpus[i].parts = parts;
+        cpus[i].arg = arg;
+        __atomic_store_n(&cpus[i].work, fn, __ATOMIC_RELEASE);
+        lapic_ipi(cpus[i].apic_id, LAPIC_IPI_FIXED | IRQ_SMP_WAKE);
+    }
+
+    fn(0, parts, arg);
+
+    for (uint32_t i = 1; i < parts; i++) {
+        while (__atomic_load_n(&cpus[i].work, __ATOMIC_ACQUIRE) != 0) asm volatile("pause");
+    }
+    mutex_unlock(&smp_lock);
+}
+
+typedef struct {
+    uint32_t limit;
+    uint32_t found[APIC_MAX_CPUS];
+} prime_work;
+
+/* Trial division over every parts'th number, nothing shared but the result slot */
+static void count_primes(uint32_t part, uint32_t parts, void *arg) {
+    prime_work *work = arg;
+    uint32_t found = 0;
+    for (uint32_t n = 2 + part; n < work->limit; n += parts) {
+        uint32_t d = 2;
+        for (; d * d <= n; d++) {
+            if (n % d == 0) break;
+        }
+        if (d * d > n) found++;
+    }
+    work->found[part] = found;
+}
+
+static uint64_t bench_run(prime_work *work, uint32_t parts, uint32_t *primes) {
+    uint64_t start = clock_ns();
+    smp_run(count_primes, work, parts);
+    uint64_t ns = clock_ns() - start;
+
+    *primes = 0;
+    for (uint32_t i = 0; i < parts; i++) *primes += work->found[i];
+    return ns;
+}
+
+void smp_bench(uint32_t limit) {
+    prime_work work;
+    work.limit = limit;
+
+    uint32_t primes;
+    uint64_t one = bench_run(&work, 1, &primes);
+    kprintf("smp cpus=1 primes=%u ns=%llu\n", primes, one);
+    if (online == 1) return;
+
+    uint64_t all = bench_run(&work, online, &primes);
+    uint32_t shift = 0;
+    while ((all >> shift) > 0xffffffff) shift++; /* div64_32 divides by 32 bits */
+    uint32_t speedup = all ? div64_32((one >> shift) * 100, all >> shift) : 0;
+    kprintf("smp cpus=%u primes=%u ns=%llu speedup=%u.%02u\n", online, primes, all, speedup / 100, speedup % 100);
+}
@@ -0,0 +1,42 @@
+#ifndef SMP_H
+#define SMP_H
+
+#include <stdint.h>
+
+/* Application processors
+ * init_smp starts every other cpu the MADT lists (cpu/apic.h) with an INIT
+ * and two startup IPIs, they begin in real mode in cpu/trampoline.asm. Each
+ * one gets its own GDT, stack and cpu_info, then halts with interrupts off
+ * except for the wake IPI, and only runs work that smp_run hands it.
+ * Threads and interrupts all stay on the boot cpu (cpu 0).
+ */
+#define TRAMPOLINE 0x8000 /* below 1MiB and page aligned, must match trampoline.asm */
+#define AP_STACK_SIZE 0x4000
+#define AP_START_MS 100
+#define SMP_BENCH_LIMIT 200000
+
+/* Part part of parts, smp_run gives cpu n part n */
+typedef void (*smp_fn)(uint32_t part, uint32_t parts, void *arg);
+
+typedef struct {
+    uint8_t id; /* 0 is the boot cpu */
+    uint8_t apic_id;
+    volatile uint8_t online;
+    uint8_t *stack;
+    volatile smp_fn work; /* cleared when it is done */
+    uint32_t part;
+    uint32_t parts;
+    void *arg;
+} cpu_info;
+
+void init_smp(); /* needs the heap and the timer */
+uint8_t smp_cpus(); /* online cpus */
+uint8_t smp_cpu(); /* the calling cpu's id */
+
+/* Runs fn on parts cpus (all of them for 0) at the same time, the caller
+ * does part 0 and returns once every part is done */
+void smp_run(smp_fn fn, void *arg, uint32_t parts);
+
+void smp_bench(uint32_t limit); /* counts primes below limit on 1 cpu and then all */
+
+#endif
@@ -0,0 +1,41 @@
+#ifndef SPINLOCK_H
+#define SPINLOCK_H
+
+#include <stdint.h>
+#include "isr.h"
+
+/* Ticket spinlocks
+ * Every cpu that wants the lock takes the next ticket and spins until the
+ * owner count reaches it, so they get it in the order they asked. They
+ * protect data the other cpus (cpu/smp.h) touch as well, code that interrupt
+ * handlers can also run needs the irqsave variants or it can deadlock
+ * against itself.
+ */
+typedef struct {
+    volatile uint16_t next;
+    volatile uint16_t owner;
+} spinlock;
+
+#define SPINLOCK_INIT { 0, 0 }
+
+static inline void spin_lock(spinlock *lock) {
+    uint16_t ticket = __atomic_fetch_add(&lock->next, 1, __ATOMIC_RELAXED);
+    while (__atomic_load_n(&lock->owner, __ATOMIC_ACQUIRE) != ticket) asm volatile("pause");
+}
+
+static inline void spin_unlock(spinlock *lock) {
+    __atomic_store_n(&lock->owner, lock->owner + 1, __ATOMIC_RELEASE);
+}
+
+static inline uint32_t spin_lock_irqsave(spinlock *lock) {
+    uint32_t flags = irq_save();
+    spin_lock(lock);
+    return flags;
+}
+
+static inline void spin_unlock_irqrestore(spinlock *lock, uint32_t flags) {
+    spin_unlock(lock);
+    irq_restore(flags);
+}
+
+#endif
@@ -1,26 +1,195 @@
 #include "timer.h"
 #include "isr.h"
 #include "ports.h"
+#include "cpuid.h"
+#include "apic.h"
 #include "../libc/function.h"
+#include "../kernel/sched.h"
+#include "../kernel/timers.h"
+#include "../kernel/prof.h"
+
+#define PIT_CHANNEL0 0x40
+#define PIT_CHANNEL2 0x42
+#define PIT_COMMAND 0x43
+#define PIT_GATE 0x61 /* bit 0 gates channel 2, bit 1 is the speaker, bit 5 reads the output of channel 2 */
+
+#define PIT_PERIODIC 0x36 /* channel 0, low then high byte, square wave */
+#define PIT_ONESHOT 0x30 /* channel 0, low then high byte, interrupt on terminal count */
+#define PIT_CALIBRATE 0xb0 /* channel 2, low then high byte, interrupt on terminal count */
+
+#define CALIBRATE_SPINS 10000000 /* gives up if channel 2 never fires */
+#define TICK_US (1000000 / TIMER_HZ)
 
 uint32_t tick = 0;
+static uint32_t ran_tick = 0; /* last tick the wheel and the scheduler saw */
+static uint32_t irqs = 0;
+
+static uint32_t khz = 0;
+static uint32_t ns_mult = 0; /* nanoseconds per cycle, fixed point with 24 fraction bits */
+static uint32_t tick_cycles = 0;
+static uint64_t tsc_base = 0;
+static uint64_t tick_tsc = 0; /* tsc at the start of the current tick */
+static int oneshot = 0;
+static uint32_t lapic_tick = 0; /* local APIC timer counts per tick, 0 while the PIT is the tick */
+
+static void pit_program(uint8_t mode, uint16_t count) {
+    port_byte_out(PIT_COMMAND, mode);
+    port_byte_out(PIT_CHANNEL0, (uint8_t)(count & 0xFF));
+    port_byte_out(PIT_CHANNEL0, (uint8_t)((count >> 8) & 0xFF));
+}
+
+/* Periodic or a single interrupt count units of the tick source from now */
+static void tick_program(int periodic, uint32_t count) {
+    if (lapic_tick) lapic_timer_start(periodic ? LAPIC_TIMER_PERIODIC : LAPIC_TIMER_ONESHOT, count);
+    else pit_program(periodic ? PIT_PERIODIC : PIT_ONESHOT, count);
+}
+
+/* Counts the ticks that passed and runs them, with a TSC the count comes
+ * from the cycle counter so interrupts that were skipped or late don't matter */
+static void advance(int pit) {
+    if (khz == 0) {
+        if (pit) tick++;
+    } else {
+        uint64_t now = rdtsc();
+        while (now - tick_tsc >= tick_cycles) {
+            tick++;
+            tick_tsc += tick_cycles;
+        }
+    }
+
+    if (tick == ran_tick) return;
+    ran_tick = tick;
+    timers_run(tick);
+    sched_tick();
+}
 
 static void timer_callback(registers_t *regs) {
-    tick++;
-    UNUSED(regs);
+    irqs++;
+    prof_sample(regs);
+    advance(1);
+}
+
+uint32_t get_tick() {
+    return tick;
+}
+
+uint32_t timer_irqs() {
+    return irqs;
+}
+
+uint32_t tsc_khz() {
+    return khz;
+}
+
+uint64_t cycles_to_ns(uint64_t cycles) {
+    /* 64 x 32 bit multiply in two halves */
+    uint64_t low = (uint64_t)(uint32_t)cycles * ns_mult;
+    uint64_t high = (uint64_t)(uint32_t)(cycles >> 32) * ns_mult;
+    return (low >> 24) + (high << 8);
 }
 
-void init_timer(uint32_t freq) {
+uint64_t clock_ns() {
+    if (khz == 0) return (uint64_t)tick * (TICK_US * 1000);
+    return cycles_to_ns(rdtsc() - tsc_base);
+}
+
+void delay_us(uint32_t us) {
+    if (khz == 0) {
+        uint32_t end = tick + us / TICK_US + 1;
+        while ((int32_t)(*(volatile uint32_t*)&tick - end) < 0) asm volatile("hlt");
+        return;
+    }
+
+    uint64_t wait = div64_32((uint64_t)khz * us, 1000);
+    uint64_t start = rdtsc();
+    while (rdtsc() - start < wait) asm volatile("pause");
+}
+
+/* Cycles per millisecond, timed over CALIBRATE_MS of PIT channel 2 (the speaker timer) */
+static uint32_t calibrate_tsc() {
+    uint32_t a, b, c, d;
+    cpuid(1, &a, &b, &c, &d);
+    if (!(d & CPUID_EDX_TSC)) return 0;
+
+    uint16_t count = PIT_HZ / 1000 * CALIBRATE_MS;
+    uint32_t flags = irq_save();
+    uint8_t gate = port_byte_in(PIT_GATE);
+    port_byte_out(PIT_GATE, (gate & ~0x02) | 0x01);
+    port_byte_out(PIT_COMMAND, PIT_CALIBRATE);
+    port_byte_out(PIT_CHANNEL2, (uint8_t)(count & 0xFF));
+    port_byte_out(PIT_CHANNEL2, (uint8_t)((count >> 8) & 0xFF));
+
+    uint64_t start = rdtsc();
+    uint32_t spins = 0;
+    while (!(port_byte_in(PIT_GATE) & 0x20) && ++spins < CALIBRATE_SPINS);
+    uint64_t cycles = rdtsc() - start;
+
+    port_byte_out(PIT_GATE, gate);
+    irq_restore(flags);
+
+    if (spins >= CALIBRATE_SPINS) return 0;
+    return div64_32(cycles * PIT_HZ, (uint32_t)count * 1000);
+}
+
+/* Local APIC timer counts in a tick, timed with the TSC */
+static uint32_t calibrate_lapic() {
+    uint64_t wait = (uint64_t)khz * CALIBRATE_MS;
+    uint32_t flags = irq_save();
+    lapic_timer_start(LAPIC_TIMER_ONESHOT, 0xffffffff);
+    uint64_t start = rdtsc();
+    while (rdtsc() - start < wait);
+    uint32_t counted = 0xffffffff - lapic_timer_count();
+    lapic_timer_stop();
+    irq_restore(flags);
+    return counted / MS_TO_TICKS(CALIBRATE_MS);
+}
+
+void init_timer() {
     /* Install the function we just wrote */
     register_interrupt_handler(IRQ0, timer_callback);
+    register_interrupt_handler(IRQ_LAPIC_TIMER, timer_callback);
+
+    /* below ~4MHz the nanosecond multiplier doesn't fit, use the tick instead */
+    khz = calibrate_tsc();
+    if (khz < 4000) khz = 0;
+    if (khz) {
+        ns_mult = div64_32(1000000ULL << 24, khz);
+        tick_cycles = khz / 1000 * TICK_US + khz % 1000 * TICK_US / 1000;
+        tsc_base = rdtsc();
+        tick_tsc = tsc_base;
+    }
+    init_timers(tick);
+
+    /* the local APIC timer needs no port io, the PIT is left to the IOAPIC's mask */
+    if (apic_enabled() && khz) lapic_tick = calibrate_lapic();
+    if (lapic_tick) ioapic_mask(0, 1);
 
-    /* Get the PIT value: hardware clock at 1193180 Hz */
-    uint32_t divisor = 1193180 / freq;
-    uint8_t low  = (uint8_t)(divisor & 0xFF);
-    uint8_t high = (uint8_t)( (divisor >> 8) & 0xFF);
-    /* Send the command */
-    port_byte_out(0x43, 0x36); /* Command port */
-    port_byte_out(0x40, low);
-    port_byte_out(0x40, high);
+    /* interrupt TIMER_HZ times a second */
+    tick_program(1, lapic_tick ? lapic_tick : PIT_DIVISOR);
 }
 
+/* Any interrupt ends a one-shot period, the periodic tick comes back */
+void timer_irq_enter() {
+    if (!oneshot) return;
+    oneshot = 0;
+    tick_program(1, lapic_tick ? lapic_tick : PIT_DIVISOR);
+    advance(0);
+}
+
+void timer_idle() {
+    asm volatile("cli");
+    uint32_t next = khz ? timers_next() : 1;
+    if (next > 1) {
+        uint32_t per_tick = lapic_tick ? lapic_tick : PIT_DIVISOR;
+        uint32_t max = lapic_tick ? 0xffffffff / lapic_tick : ONESHOT_MAX_TICKS;
+        if (next > max) next = max;
+
+        /* part of the current tick is gone already */
+        uint64_t elapsed = rdtsc() - tick_tsc;
+        uint32_t used = elapsed < tick_cycles ? div64_32(elapsed * per_tick, tick_cycles) : per_tick - 1;
+        tick_program(0, next * per_tick - used);
+        oneshot = 1;
+    }
+    /* sti only takes effect after hlt starts, an interrupt can't slip in between */
+    asm volatile("sti; hlt");
+}
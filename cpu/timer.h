@@ -3,6 +3,51 @@
 
 #include <stdint.h>
 
-void init_timer(uint32_t freq);
+/* Timekeeping
+ * The PIT interrupts TIMER_HZ times a second while the cpu is busy, every
+ * interrupt is a tick (get_tick) that runs the timer wheel (kernel/timers.h)
+ * and the scheduler. When the idle thread halts, timer_idle programs a
+ * single interrupt for the next timer instead (up to ONESHOT_MAX_TICKS),
+ * the ticks that were skipped are counted from the TSC on the next interrupt.
+ * With a local APIC (cpu/apic.h) and a TSC to measure it, the APIC timer
+ * takes the place of the PIT, and one-shots can be much longer.
+ *
+ * clock_ns is a monotonic nanosecond clock from the TSC, calibrated against
+ * PIT channel 2 at boot. Without a TSC it falls back to the tick.
+ */
+#define TIMER_HZ 1000
+#define PIT_HZ 1193182
+#define PIT_DIVISOR (PIT_HZ / TIMER_HZ)
+#define ONESHOT_MAX_TICKS (0xffff / PIT_DIVISOR) /* for the PIT */
+#define CALIBRATE_MS 10
+
+#define MS_TO_TICKS(ms) ((ms) * TIMER_HZ / 1000)
+
+void init_timer();
+uint32_t get_tick();
+uint32_t timer_irqs(); /* interrupts the PIT raised so far */
+
+uint64_t clock_ns();
+uint64_t cycles_to_ns(uint64_t cycles);
+uint32_t tsc_khz(); /* 0 if the TSC isn't used */
+
+void delay_us(uint32_t us); /* busy waits, without a TSC it needs interrupts on */
+
+void timer_irq_enter(); /* called first thing by irq_handler */
+void timer_idle(); /* halts until the next interrupt, without ticks if nothing is due */
+
+/* Cycle counter, good for timing things much shorter than a tick */
+static inline uint64_t rdtsc() {
+    uint32_t low, high;
+    asm volatile("rdtsc" : "=a" (low), "=d" (high));
+    return ((uint64_t)high << 32) | low;
+}
+
+/* 64 by 32 bit division with divl, the quotient has to fit in 32 bits (there is no libgcc) */
+static inline uint32_t div64_32(uint64_t n, uint32_t d) {
+    uint32_t q, r;
+    asm("divl %4" : "=a" (q), "=d" (r) : "a" ((uint32_t)n), "d" ((uint32_t)(n >> 32)), "rm" (d));
+    return q;
+}
 
 #endif
@@ -0,0 +1,56 @@
+; Application processors start here in real mode after the startup IPI.
+; cpu/smp.c copies this to TRAMPOLINE and fills in the stack and the entry,
+; so every address in it is made relative to that copy.
+TRAMPOLINE equ 0x8000
+%define ABS(label) (label - trampoline_start + TRAMPOLINE)
+
+global trampoline_start
+global trampoline_end
+global trampoline_stack
+global trampoline_entry
+
+[bits 16]
+trampoline_start:
+    cli
+    xor ax, ax
+    mov ds, ax
+    lgdt [ABS(tramp_gdt_descriptor)]
+    mov eax, cr0
+    or eax, 0x1
+    mov cr0, eax
+    jmp dword 0x08:ABS(tramp_pm)
+
+[bits 32]
+tramp_pm:
+    mov ax, 0x10
+    mov ds, ax
+    mov ss, ax
+    mov es, ax
+    mov fs, ax
+    mov gs, ax
+
+    mov esp, [ABS(trampoline_stack)]
+    mov eax, [ABS(trampoline_entry)]
+    call eax ; never returns
+    jmp $
+
+; flat code and data, like boot/gdt.asm
+align 8
+tramp_gdt:
+    dd 0x0
+    dd 0x0
+    dw 0xffff, 0x0
+    db 0x0, 10011010b, 11001111b, 0x0
+    dw 0xffff, 0x0
+    db 0x0, 10010010b, 11001111b, 0x0
+
+tramp_gdt_descriptor:
+    dw tramp_gdt_descriptor - tramp_gdt - 1
+    dd ABS(tramp_gdt)
+
+align 4
+trampoline_stack:
+    dd 0
+trampoline_entry:
+    dd 0
+trampoline_end:
@@ -2,13 +2,16 @@
 
 #include "../cpu/ports.h"
 #include "../cpu/isr.h"
+#include "../cpu/timer.h"
 
 #include "screen.h"
 #include "../libc/mem.h"
+#include "../kernel/log.h"
 
 const uint16_t io_base = 0x01f0;
 
 uint8_t* identify_buf = 0x0;
+uint32_t ata_sectors = 0;
 
 #define ATA_PRIMARY_IO 0x1f0
 #define ATA_SECONDARY_IO 0x170
@@ -30,36 +33,38 @@ void ata_400ns_delay()
 		port_byte_in(io_base + ATA_ALT_STATUS_REG);
 }
 
-uint16_t timeout = 0;
-#define TIMEOUT 1000 //this amount of timeout seems to work
+uint8_t timed_out = 0;
+#define ATA_TIMEOUT_NS 100000000 //100ms, a real timeout instead of a loop count that depends on the cpu
 void ata_poll(uint16_t io)
 {
-	timeout = 0;
+	timed_out = 0;
 	
 	ata_400ns_delay();
+	uint64_t deadline = clock_ns() + ATA_TIMEOUT_NS;
 	uint8_t status;
 	do
 	{
 		status = port_byte_in(io + ATA_STATUS_REG);
-		if (timeout++ > TIMEOUT)
+		if (clock_ns() > deadline)
 		{
-			kprint("ATA timeout!\n");
+			klog(LOG_ERR, "ATA timeout!\n");
+			timed_out = 1;
 			return;
 		}
 	} while (status & ATA_SR_BSY);
 	
-	timeout = 0;
 	do
 	{
 		status = port_byte_in(io + ATA_STATUS_REG);
 		if (status & ATA_SR_ERR)
 		{
-			kprint("ATA error!\n");
+			klog(LOG_ERR, "ATA error!\n");
 		}
 		
-		if (timeout++ > TIMEOUT)
+		if (clock_ns() > deadline)
 		{
-			kprint("ATA timeout!\n");
+			klog(LOG_ERR, "ATA timeout!\n");
+			timed_out = 1;
 			return;
 		}
 	} while(!(status & ATA_SR_DRQ));
@@ -84,7 +89,7 @@ uint8_t ata_identify(uint8_t bus, uint8_t drive)
 	if (status)
 	{
 		ata_poll(io);
-		if (timeout > TIMEOUT)
+		if (timed_out)
 		{
 			return 0;
 		}
@@ -122,7 +127,7 @@ void lba_read_one(uint32_t lba, uint8_t* buffer)
 	port_byte_out(io_base + ATA_CMD_REG, ATA_CMD_READ_PIO); //Read with retry
 	
 	ata_poll(io_base);
-	if (timeout > TIMEOUT)
+	if (timed_out)
 	{
 		return;
 	}
@@ -140,7 +145,7 @@ void lba_read(uint32_t lba, uint32_t sectors, uint8_t* buffer)
 	for (uint32_t i = 0; i < sectors; i++)
 	{
 		lba_read_one(lba + i, buffer);
-		if (timeout > TIMEOUT)
+		if (timed_out)
 		{
 			i--; //retry on timeout
 		}
@@ -158,7 +163,7 @@ void lba_write_one(uint32_t lba, uint8_t* buffer)
 	port_byte_out(io_base + ATA_CMD_REG, ATA_CMD_WRITE_PIO); //Read with retry
 	
 	ata_poll(io_base);
-	if (timeout > TIMEOUT)
+	if (timed_out)
 	{
 		return;
 	}
@@ -175,7 +180,7 @@ void lba_write(uint32_t lba, uint32_t sectors, uint8_t* buffer)
 	for (uint32_t i = 0; i < sectors; i++)
 	{
 		lba_write_one(lba + i, buffer);
-		if (timeout > TIMEOUT)
+		if (timed_out)
 		{
 			i--; //retry on timeout
 		}
@@ -192,6 +197,7 @@ void ata_probe()
 	if(ata_identify(ATA_PRIMARY, ATA_MASTER))
 	{
 		kprint("Master ata drive exists! ");	
+		ata_sectors = *(uint32_t*)(identify_buf + ATA_IDENT_MAX_LBA); //28 bit addressable sectors
 	}
 	else
 	{
@@ -206,23 +212,9 @@ void ata_probe()
 	kprint_color(WHITE_TEXT);
 }
 
-void primary_irq()
-{
-	port_byte_out(0xA0, 0x20);
-	port_byte_out(0x20, 0x20);
-}
-
-void secondary_irq()
-{
-	port_byte_out(0xA0, 0x20);
-	port_byte_out(0x20, 0x20);
-}
-
 void initialize_ata()
 {
 	identify_buf = kmalloc(512);
-	register_interrupt_handler(IRQ14, primary_irq); 
-	register_interrupt_handler(IRQ15, secondary_irq); 
 	ata_probe();
 	kfree(identify_buf);
 }
@@ -71,6 +71,8 @@
 #define ATA_DEVICE_CONTROL_REG 0 //write
 #define ATA_DRIVE_ADDR_REG 1 //read
 
+extern uint32_t ata_sectors; //size of the master drive, 0 if there is none
+
 void lba_read(uint32_t lba, uint32_t sectors, uint8_t* buffer);
 void lba_read_one(uint32_t lba, uint8_t* buffer);
 
@@ -5,15 +5,26 @@
 #include "../libc/string.h"
 #include "../libc/function.h"
 #include "../kernel/kernel.h"
+#include "../kernel/sched.h"
 #include <stdint.h>
 
 #define BACKSPACE 0x0E
 #define ENTER 0x1C
 #define LSHIFT 0x2A
 #define RSHIFT 0x36
+#define PGUP 0x49
+#define PGDN 0x51
 
 static char key_buffer[256];
 
+/* scancodes go from the IRQ to the shell thread through this ring,
+ * the IRQ only writes head and keyboard_process only writes tail */
+#define SCANCODE_RING_SIZE 64 /* must be a power of two */
+static uint8_t scancodes[SCANCODE_RING_SIZE];
+static volatile uint32_t sc_head = 0;
+static volatile uint32_t sc_tail = 0;
+static wait_queue key_waiters;
+
 #define SC_MAX 57
 /*const char *sc_name[] = { "ERROR", "Esc", "1", "2", "3", "4", "5", "6", 
     "7", "8", "9", "0", "-", "=", "Backspace", "Tab", "Q", "W", "E", 
@@ -113,7 +124,22 @@ char get_ascii(uint8_t scancode)
 static void keyboard_callback(registers_t *regs) {
     /* The PIC leaves us the scancode in port 0x60 */
     uint8_t scancode = port_byte_in(0x60);
-    
+
+    /* a full ring drops the key, the shell is stuck in a command anyway */
+    if (sc_head - sc_tail < SCANCODE_RING_SIZE) {
+        scancodes[sc_head & (SCANCODE_RING_SIZE - 1)] = scancode;
+        asm volatile("" : : : "memory");
+        sc_head++;
+    }
+    thread_wakeup(&key_waiters);
+    UNUSED(regs);
+}
+
+int keyboard_pending() {
+    return sc_head != sc_tail;
+}
+
+static void handle_scancode(uint8_t scancode) {
     switch (scancode)
     {
     	case BACKSPACE:
@@ -131,6 +157,12 @@ static void keyboard_callback(registers_t *regs) {
         case RSHIFT + 0x80:
         	inputFlags ^= SHIFT_FLAG;
         	break;
+        case PGUP:
+        	scroll_view(MAX_ROWS - 1);
+        	break;
+        case PGDN:
+        	scroll_view(-(MAX_ROWS - 1));
+        	break;
         default:
         {
         	if (scancode > SC_MAX) return;
@@ -141,7 +173,21 @@ static void keyboard_callback(registers_t *regs) {
         	kprint(str);
         }
     }	
-    UNUSED(regs);
+}
+
+void keyboard_process() {
+    while (sc_tail != sc_head) {
+        uint8_t scancode = scancodes[sc_tail & (SCANCODE_RING_SIZE - 1)];
+        asm volatile("" : : : "memory");
+        sc_tail++;
+        handle_scancode(scancode);
+    }
+}
+
+void keyboard_wait() {
+    uint32_t flags = irq_save();
+    if (sc_head == sc_tail) thread_wait(&key_waiters);
+    irq_restore(flags);
 }
 
 void init_keyboard() {
@@ -2,5 +2,8 @@
 #define KEYBOARD_H
 
 void init_keyboard();
+void keyboard_process(); /* handles queued keys, called from the shell thread */
+int keyboard_pending();
+void keyboard_wait(); /* blocks the calling thread until a key is queued */
 
 #endif
@@ -1,15 +1,58 @@
 #include "screen.h"
 #include "../cpu/ports.h"
+#include "../cpu/isr.h"
 #include "../libc/mem.h"
+#include "../libc/printf.h"
 #include <stdint.h>
 
+/* Console model
+ * Output goes to a ring of lines and the cursor is tracked in software,
+ * so printing a character doesn't touch the VGA ports at all.
+ * The screen shows the last MAX_ROWS lines of the ring, screen row r is
+ * ring line (top + r). Scrolling just advances top, the lines that leave
+ * the screen stay in the ring as scrollback (see init_scrollback).
+ *
+ * The cursor is a row and column of the screen, so printing a character
+ * doesn't divide to find its line.
+ * Rows written since the last flush form a dirty range, flush_screen copies
+ * them to video memory and moves the hardware cursor once per kprint call.
+ * The screen is a window of VGA_ROWS rows of video memory and the CRTC start
+ * address selects the window, so a scroll only rewrites the new bottom row.
+ * When the window hits the end of video memory it starts over at row 0 with
+ * one full copy.
+ *
+ * Threads share the console, every public function that prints runs with
+ * interrupts disabled so a switch can't land in the middle of a line.
+ */
+#define LINE_BYTES (MAX_COLS * 2)
+#define BOOT_LINES 32 /* ring used until the heap is up, a power of two >= MAX_ROWS */
+
+static uint8_t boot_ring[BOOT_LINES * LINE_BYTES] __attribute__((aligned(4)));
+static uint8_t *ring = boot_ring;
+static uint32_t ring_mask = BOOT_LINES - 1;
+static uint32_t top = 0; /* lines scrolled off the screen so far */
+
+static int view_back = 0; /* lines the view is scrolled back, 0 is live */
+static int window_row = 0; /* first row of video memory the screen is shown from */
+static int hw_window_row = -1;
+
+static void (*mirror)(char *text, int len) = 0x0;
+
+static int cursor_row = 0;
+static int cursor_col = 0;
+static int hw_cursor = -1; /* character index last written to the CRTC, relative to the window */
+static int dirty_first = MAX_ROWS;
+static int dirty_last = -1;
+
 /* Declaration of private functions */
-int get_cursor_offset();
-void set_cursor_offset(int offset);
+void flush_screen();
+void mark_dirty(int first, int last);
+void copy_words(uint32_t *source, uint32_t *dest, int words);
+uint8_t *ring_line(uint32_t line);
+void scroll_line();
+void set_crtc(uint8_t reg, int value);
 int print_char(char c, int col, int row, char attr);
 int get_offset(int col, int row);
-int get_offset_row(int offset);
-int get_offset_col(int offset);
 
 /**********************************************************
  * Public Kernel API functions                            *
@@ -27,35 +70,104 @@ void kprint_color(unsigned char color)
  * If col, row, are negative, we will use the current offset
  */
 void kprint_at(char *message, int col, int row) {
-    /* Set cursor if col/row are negative */
-    int offset;
-    if (col >= 0 && row >= 0)
-        offset = get_offset(col, row);
-    else {
-        offset = get_cursor_offset();
-        row = get_offset_row(offset);
-        col = get_offset_col(offset);
+    uint32_t flags = irq_save();
+    /* Move the cursor unless col/row are negative */
+    if (col >= MAX_COLS || row >= MAX_ROWS) {
+        print_char(0, col, row, printColor); /* error marker */
+        flush_screen();
+        irq_restore(flags);
+        return;
+    }
+    if (col >= 0 && row >= 0) {
+        cursor_row = row;
+        cursor_col = col;
+        if (mirror) mirror("\n", 1); /* a serial terminal can't jump around */
     }
 
-    /* Loop through message and print it */
+    /* Loop through message and print it, print_char keeps the cursor */
     int i = 0;
-    while (message[i] != 0) {
-        offset = print_char(message[i++], col, row, printColor);
-        /* Compute row/col for next iteration */
-        row = get_offset_row(offset);
-        col = get_offset_col(offset);
-    }
+    while (message[i] != 0)
+        print_char(message[i++], -1, -1, printColor);
+    flush_screen();
+    if (mirror) mirror(message, i);
+    irq_restore(flags);
 }
 
 void kprint(char *message) {
     kprint_at(message, -1, -1);
 }
 
+/* Prints exactly len characters, message doesn't need to be null terminated */
+void kprint_n(char *message, int len) {
+    uint32_t flags = irq_save();
+    int i;
+    for (i = 0; i < len; i++)
+        print_char(message[i], -1, -1, printColor);
+    flush_screen();
+    if (mirror) mirror(message, len);
+    irq_restore(flags);
+}
+
+/* Everything printed from now on is also passed to fn (0x0 turns it off) */
+void kprint_set_mirror(void (*fn)(char *text, int len)) {
+    mirror = fn;
+}
+
+/* Moves the heap-less boot ring to a SCROLLBACK_LINES ring, call once the heap is up */
+void init_scrollback() {
+    uint8_t *lines = kmalloc(SCROLLBACK_LINES * LINE_BYTES);
+    if (lines == 0x0) return;
+    memset(lines, 0, SCROLLBACK_LINES * LINE_BYTES);
+
+    int row;
+    for (row = 0; row < MAX_ROWS; row++)
+        copy_words((uint32_t*)ring_line(top + row),
+                   (uint32_t*)(lines + ((top + row) & (SCROLLBACK_LINES - 1)) * LINE_BYTES),
+                   LINE_BYTES / 4);
+
+    ring = lines;
+    ring_mask = SCROLLBACK_LINES - 1;
+}
+
+/* Moves the view lines back into the scrollback (negative goes forward) */
+void scroll_view(int lines) {
+    uint32_t flags = irq_save();
+    int max = top < ring_mask + 1 - MAX_ROWS ? top : ring_mask + 1 - MAX_ROWS;
+    int back = view_back + lines;
+    if (back < 0) back = 0;
+    if (back > max) back = max;
+    if (back != view_back) {
+        view_back = back;
+        mark_dirty(0, MAX_ROWS-1);
+        flush_screen();
+    }
+    irq_restore(flags);
+}
+
+/* Formats into a stack buffer and prints it with a single flush, see libc/printf.h */
+void kprintf(char *fmt, ...) {
+    char buf[KPRINTF_MAX];
+    va_list args;
+    va_start(args, fmt);
+    int len = kvsnprintf(buf, KPRINTF_MAX, fmt, args);
+    va_end(args);
+
+    if (len >= KPRINTF_MAX) len = KPRINTF_MAX - 1; /* cut, not dropped */
+    kprint_n(buf, len);
+}
+
 void kprint_backspace() {
-    int offset = get_cursor_offset()-2;
-    int row = get_offset_row(offset);
-    int col = get_offset_col(offset);
+    uint32_t flags = irq_save();
+    int row = cursor_row;
+    int col = cursor_col - 1;
+    if (col < 0) {
+        col = MAX_COLS - 1;
+        if (--row < 0) row = col = 0;
+    }
     print_char(0x08, col, row, printColor);
+    flush_screen();
+    if (mirror) mirror("\b \b", 3);
+    irq_restore(flags);
 }
 
 
@@ -65,93 +177,154 @@ void kprint_backspace() {
 
 
 /**
- * Innermost print function for our kernel, directly accesses the video memory 
+ * Innermost print function for our kernel, writes to the shadow screen
  *
  * If 'col' and 'row' are negative, we will print at current cursor location
  * If 'attr' is zero it will use current printColor as default
  * Returns the offset of the next character
- * Sets the video cursor to the returned offset
+ * Moves the cursor there, the screen changes on the next flush_screen
  */
 int print_char(char c, int col, int row, char attr) {
-    uint8_t *vidmem = (uint8_t*) VIDEO_ADDRESS;
     if (!attr) attr = printColor;
 
+    /* new output always shows up live */
+    if (view_back != 0) {
+        view_back = 0;
+        mark_dirty(0, MAX_ROWS-1);
+    }
+
     /* Error control: print a red 'E' if the coords aren't right */
     if (col >= MAX_COLS || row >= MAX_ROWS) {
-        vidmem[2*(MAX_COLS)*(MAX_ROWS)-2] = 'E';
-        vidmem[2*(MAX_COLS)*(MAX_ROWS)-1] = RED_ON_WHITE;
+        uint8_t *last_line = ring_line(top + MAX_ROWS-1);
+        last_line[LINE_BYTES-2] = 'E';
+        last_line[LINE_BYTES-1] = RED_ON_WHITE;
+        mark_dirty(MAX_ROWS-1, MAX_ROWS-1);
         return get_offset(col, row);
     }
 
-    int offset;
-    if (col >= 0 && row >= 0) offset = get_offset(col, row);
-    else offset = get_cursor_offset();
+    if (col < 0 || row < 0) {
+        col = cursor_col;
+        row = cursor_row;
+    }
 
+    uint8_t *line = ring_line(top + row);
     if (c == '\n') {
-        row = get_offset_row(offset);
-        offset = get_offset(0, row+1);
+        col = 0;
+        row++;
     } else if (c == 0x08) { /* Backspace */
-        vidmem[offset] = ' ';
-        vidmem[offset+1] = attr;
+        line[col*2] = ' ';
+        line[col*2+1] = attr;
+        mark_dirty(row, row);
     } else {
-        vidmem[offset] = c;
-        vidmem[offset+1] = attr;
-        offset += 2;
+        line[col*2] = c;
+        line[col*2+1] = attr;
+        mark_dirty(row, row);
+        if (++col == MAX_COLS) {
+            col = 0;
+            row++;
+        }
     }
 
-    /* Check if the offset is over screen size and scroll */
-    if (offset >= MAX_ROWS * MAX_COLS * 2) {
-        int i;
-        for (i = 1; i < MAX_ROWS; i++) 
-            memcpy((uint8_t*)(get_offset(0, i) + VIDEO_ADDRESS),
-                        (uint8_t*)(get_offset(0, i-1) + VIDEO_ADDRESS),
-                        MAX_COLS * 2);
+    /* Check if the cursor is below the screen and scroll */
+    if (row >= MAX_ROWS) {
+        scroll_line();
+        row = MAX_ROWS-1;
+    }
+
+    cursor_row = row;
+    cursor_col = col;
+    return get_offset(col, row);
+}
 
-        /* Blank last line */
-        char *last_line = (char*) (get_offset(0, MAX_ROWS-1) + (uint8_t*) VIDEO_ADDRESS);
-        for (i = 0; i < MAX_COLS * 2; i++) last_line[i] = 0;
+uint8_t *ring_line(uint32_t line) {
+    return ring + (line & ring_mask) * LINE_BYTES;
+}
+
+/* The top line goes to the scrollback and the window moves down a row,
+ * rows already in video memory slide up with it so the dirty range does too */
+void scroll_line() {
+    top++;
 
-        offset -= 2 * MAX_COLS;
+    /* Blank last line */
+    uint8_t *last_line = ring_line(top + MAX_ROWS-1);
+    int i;
+    for (i = 0; i < LINE_BYTES; i++) last_line[i] = 0;
+
+    window_row++;
+    if (window_row + MAX_ROWS > VGA_ROWS) {
+        window_row = 0;
+        mark_dirty(0, MAX_ROWS-1);
+        return;
+    }
+
+    if (dirty_last >= 0) {
+        if (dirty_first > 0) dirty_first--;
+        dirty_last--;
+        if (dirty_last < dirty_first) dirty_first = MAX_ROWS;
     }
+    mark_dirty(MAX_ROWS-1, MAX_ROWS-1);
+}
 
-    set_cursor_offset(offset);
-    return offset;
+void mark_dirty(int first, int last) {
+    if (first < dirty_first) dirty_first = first;
+    if (last > dirty_last) dirty_last = last;
 }
 
-int get_cursor_offset() {
-    /* Use the VGA ports to get the current cursor position
-     * 1. Ask for high byte of the cursor offset (data 14)
-     * 2. Ask for low byte (data 15)
-     */
-    port_byte_out(REG_SCREEN_CTRL, 14);
-    int offset = port_byte_in(REG_SCREEN_DATA) << 8; /* High byte: << 8 */
-    port_byte_out(REG_SCREEN_CTRL, 15);
-    offset += port_byte_in(REG_SCREEN_DATA);
-    return offset * 2; /* Position * size of character cell */
+/* the screen is word aligned and rows are 160 bytes, so whole rows copy as words */
+void copy_words(uint32_t *source, uint32_t *dest, int words) {
+    int i;
+    for (i = 0; i < words; i++) dest[i] = source[i];
 }
 
-void set_cursor_offset(int offset) {
-    /* Similar to get_cursor_offset, but instead of reading we write data */
-    offset /= 2;
-    port_byte_out(REG_SCREEN_CTRL, 14);
-    port_byte_out(REG_SCREEN_DATA, (uint8_t)(offset >> 8));
-    port_byte_out(REG_SCREEN_CTRL, 15);
-    port_byte_out(REG_SCREEN_DATA, (uint8_t)(offset & 0xff));
+/* Writes a 16 bit CRTC register pair, high byte at reg then low byte at reg+1 */
+void set_crtc(uint8_t reg, int value) {
+    port_byte_out(REG_SCREEN_CTRL, reg);
+    port_byte_out(REG_SCREEN_DATA, (uint8_t)(value >> 8));
+    port_byte_out(REG_SCREEN_CTRL, reg + 1);
+    port_byte_out(REG_SCREEN_DATA, (uint8_t)(value & 0xff));
+}
+
+/* Copies the dirty rows to video memory, then moves the window and the hardware cursor if they changed */
+void flush_screen() {
+    uint8_t *window = (uint8_t*)VIDEO_ADDRESS + window_row * LINE_BYTES;
+    int row;
+    for (row = dirty_first; row <= dirty_last; row++)
+        copy_words((uint32_t*)ring_line(top - view_back + row),
+                   (uint32_t*)(window + row * LINE_BYTES), LINE_BYTES / 4);
+    dirty_first = MAX_ROWS;
+    dirty_last = -1;
+
+    if (window_row != hw_window_row) {
+        set_crtc(REG_START_ADDRESS, window_row * MAX_COLS);
+        hw_window_row = window_row;
+        hw_cursor = -1; /* the cursor address is absolute, not relative to the window */
+    }
+
+    /* park the cursor off screen while looking at the scrollback */
+    int cursor = view_back ? MAX_ROWS * MAX_COLS : cursor_row * MAX_COLS + cursor_col;
+    if (cursor != hw_cursor) {
+        set_crtc(REG_CURSOR, window_row * MAX_COLS + cursor);
+        hw_cursor = cursor;
+    }
 }
 
 void clear_screen() {
+    uint32_t flags = irq_save();
     int screen_size = MAX_COLS * MAX_ROWS;
     int i;
-    uint8_t *screen = (uint8_t*) VIDEO_ADDRESS;
 
+    view_back = 0;
     for (i = 0; i < screen_size; i++) {
-        screen[i*2] = ' ';
-        screen[i*2+1] = printColor;
+        uint8_t *line = ring_line(top + i / MAX_COLS);
+        line[(i % MAX_COLS) * 2] = ' ';
+        line[(i % MAX_COLS) * 2 + 1] = printColor;
     }
-    set_cursor_offset(get_offset(0, 0));
+    cursor_row = 0;
+    cursor_col = 0;
+    mark_dirty(0, MAX_ROWS-1);
+    flush_screen();
+    irq_restore(flags);
 }
 
 
 int get_offset(int col, int row) { return 2 * (row * MAX_COLS + col); }
-int get_offset_row(int offset) { return offset / (2 * MAX_COLS); }
-int get_offset_col(int offset) { return (offset - (get_offset_row(offset)*2*MAX_COLS))/2; }
@@ -4,6 +4,9 @@
 #define VIDEO_ADDRESS 0xb8000
 #define MAX_ROWS 25
 #define MAX_COLS 80
+#define VGA_ROWS 200 /* rows of text that fit in the 32KiB at VIDEO_ADDRESS */
+#define SCROLLBACK_LINES 2048 /* must be a power of two */
+#define KPRINTF_MAX 256 /* longer kprintf messages are cut */
 #define WHITE_ON_BLACK 0x0f
 #define RED_ON_WHITE 0xf4
 
@@ -46,12 +49,19 @@
 /* Screen i/o ports */
 #define REG_SCREEN_CTRL 0x3d4
 #define REG_SCREEN_DATA 0x3d5
+#define REG_START_ADDRESS 0x0c /* CRTC index of the high byte, low byte follows */
+#define REG_CURSOR 0x0e
 
 /* Public kernel API */
 void clear_screen();
 void kprint_color(unsigned char color);
 void kprint_at(char *message, int col, int row);
 void kprint(char *message);
+void kprint_n(char *message, int len);
+void kprintf(char *fmt, ...);
+void kprint_set_mirror(void (*fn)(char *text, int len));
 void kprint_backspace();
+void init_scrollback();
+void scroll_view(int lines);
 
 #endif
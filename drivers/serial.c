@@ -0,0 +1,93 @@
+#include "serial.h"
+
+#include "../cpu/ports.h"
+#include "../cpu/isr.h"
+#include "../libc/function.h"
+
+#define SERIAL_DATA 0
+#define SERIAL_IER 1 //interrupt enable, divisor high byte with DLAB
+#define SERIAL_IIR 2 //interrupt id on read, FIFO control on write
+#define SERIAL_LCR 3
+#define SERIAL_MCR 4
+#define SERIAL_LSR 5
+
+#define LSR_THR_EMPTY 0x20
+#define IER_THR_EMPTY 0x02
+#define IIR_FIFO_ENABLED 0xc0
+
+#define SERIAL_MASK (SERIAL_RING_SIZE - 1)
+
+static char tx_ring[SERIAL_RING_SIZE];
+static volatile uint32_t tx_head = 0; //next byte written
+static volatile uint32_t tx_tail = 0; //next byte sent
+
+static uint8_t serial_present = 0;
+static uint8_t tx_fifo = 1; //bytes we may load per THR empty
+
+//loads the FIFO from the ring, only once the transmitter asks for more
+static void serial_fill()
+{
+	if (!(port_byte_in(COM1 + SERIAL_LSR) & LSR_THR_EMPTY)) return;
+	
+	for (uint8_t i = 0; i < tx_fifo && tx_tail != tx_head; i++)
+	{
+		port_byte_out(COM1 + SERIAL_DATA, tx_ring[tx_tail & SERIAL_MASK]);
+		tx_tail++;
+	}
+}
+
+static void serial_callback(registers_t* regs)
+{
+	port_byte_in(COM1 + SERIAL_IIR); //acknowledges the THR empty interrupt
+	serial_fill();
+	UNUSED(regs);
+}
+
+static void serial_push(char c)
+{
+	while (tx_head - tx_tail >= SERIAL_RING_SIZE)
+	{
+		serial_fill(); //full, wait for the FIFO instead of losing output
+	}
+	tx_ring[tx_head & SERIAL_MASK] = c;
+	tx_head++;
+}
+
+void serial_write(char* data, int len)
+{
+	if (!serial_present) return;
+	
+	uint32_t flags = irq_save();
+	for (int i = 0; i < len; i++)
+	{
+		if (data[i] == '\n') serial_push('\r');
+		serial_push(data[i]);
+	}
+	serial_fill(); //kick the transmitter if it is idle, the interrupt does the rest
+	irq_restore(flags);
+}
+
+void init_serial()
+{
+	uint16_t divisor = 115200 / SERIAL_BAUD;
+	
+	port_byte_out(COM1 + SERIAL_IER, 0x00);
+	port_byte_out(COM1 + SERIAL_LCR, 0x80); //DLAB on
+	port_byte_out(COM1 + SERIAL_DATA, divisor & 0xff);
+	port_byte_out(COM1 + SERIAL_IER, divisor >> 8);
+	port_byte_out(COM1 + SERIAL_LCR, 0x03); //8N1, DLAB off
+	port_byte_out(COM1 + SERIAL_IIR, 0xc7); //enable and clear the FIFOs, 14 byte receive threshold
+	
+	//loopback test, there may be no UART at all
+	port_byte_out(COM1 + SERIAL_MCR, 0x1e);
+	port_byte_out(COM1 + SERIAL_DATA, 0xae);
+	if (port_byte_in(COM1 + SERIAL_DATA) != 0xae) return;
+	
+	//an 8250/16450 has no FIFO and ignores the enable
+	if ((port_byte_in(COM1 + SERIAL_IIR) & IIR_FIFO_ENABLED) == IIR_FIFO_ENABLED) tx_fifo = 16;
+	
+	port_byte_out(COM1 + SERIAL_MCR, 0x0b); //DTR, RTS and OUT2 (routes the interrupt to the PIC)
+	register_interrupt_handler(IRQ4, serial_callback);
+	port_byte_out(COM1 + SERIAL_IER, IER_THR_EMPTY);
+	serial_present = 1;
+}
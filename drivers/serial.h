@@ -0,0 +1,19 @@
+#ifndef SERIAL_H
+#define SERIAL_H
+
+#include <stdint.h>
+
+/* 16550 UART on COM1
+output is queued in a ring and moved into the 16 byte transmit FIFO by the
+THR empty interrupt (IRQ4), so writers only copy bytes.
+when the ring is full the writer drains it by polling instead of dropping output.
+*/
+
+#define COM1 0x3f8
+#define SERIAL_BAUD 115200
+#define SERIAL_RING_SIZE 4096 //must be a power of two
+
+void init_serial();
+void serial_write(char* data, int len); //'\n' goes out as "\r\n"
+
+#endif
@@ -0,0 +1,57 @@
+#include "boot.h"
+#include "filesystem.h"
+
+#include "../cpu/paging.h"
+#include "../libc/string.h"
+
+boot_info boot = { 0, 0, 0, 0x80, 0 };
+
+//end of the usable region the frames start in, the frame allocator can't use holes
+static uint32_t mmap_end(multiboot_info* mb)
+{
+	uint32_t end = 0;
+	uint32_t addr = mb->mmap_addr;
+	while (addr < mb->mmap_addr + mb->mmap_length)
+	{
+		multiboot_mmap* m = (multiboot_mmap*)addr;
+		uint64_t last = m->addr + m->len;
+		if (m->type == MB_MEMORY_AVAILABLE && m->addr <= FRAME_BASE && last > FRAME_BASE)
+		{
+			end = last > 0xfffff000 ? 0xfffff000 : (uint32_t)last;
+		}
+		addr += m->size + 4;
+	}
+	return end != 0 ? end : FRAME_BASE; //no frames at all
+}
+
+//the words of the command line that mean something to the kernel
+static void parse_cmdline(char* cmd)
+{
+	while (*cmd != '\0')
+	{
+		while (*cmd == ' ') cmd++;
+		if (cmd[0] == 'f' && cmd[1] == 's' && cmd[2] == '=') kernel_end = boot.fs_lba = stoi(cmd + 3);
+		while (*cmd != ' ' && *cmd != '\0') cmd++;
+	}
+}
+
+static void init_multiboot(multiboot_info* mb)
+{
+	boot.magic = MULTIBOOT_MAGIC;
+	if (mb->flags & MB_INFO_BOOTDEV) boot.drive = mb->boot_device >> 24;
+	if (mb->flags & MB_INFO_MMAP) boot.mem_end = mmap_end(mb);
+	else if (mb->flags & MB_INFO_MEMORY) boot.mem_end = mb->mem_upper < 0x3ffc00 ? 0x100000 + mb->mem_upper * 1024 : 0xfffff000;
+	if (mb->flags & MB_INFO_CMDLINE) parse_cmdline((char*)mb->cmdline);
+}
+
+void init_boot(uint32_t magic, void* info)
+{
+	if (info == 0x0) return;
+
+	if (magic == MULTIBOOT_MAGIC) init_multiboot(info);
+	else if (magic == BOOT_MAGIC)
+	{
+		boot = *(boot_info*)info;
+		kernel_end = boot.fs_lba;
+	}
+}
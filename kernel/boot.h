@@ -0,0 +1,58 @@
+#ifndef BOOT_H
+#define BOOT_H
+
+#include <stdint.h>
+
+/* Boot information
+the loader leaves a magic number in eax and a pointer to what it knows in ebx, kernel_entry.asm passes both to kernel_main.
+boot/stage2.asm hands over a boot_info, its sizes are from the build (boot/kernel.inc), only the drive is filled in at boot.
+a multiboot loader (qemu -kernel kernel-mb.elf, see the Makefile) hands over a multiboot_info instead, the boot device,
+the memory map and the command line come from it. it doesn't know about the filesystem, "fs=<lba>" on the command line says where it is.
+with an unknown magic, or without fs=, fs_lba stays 0 and the filesystem isn't mounted (init_filesystem).
+*/
+
+#define BOOT_MAGIC 0x42534f4a //"JOSB", boot/layout.inc
+#define MULTIBOOT_MAGIC 0x2badb002
+
+typedef struct {
+	uint32_t magic;
+	uint32_t fs_lba; //first sector after the kernel, where the filesystem starts
+	uint32_t kernel_sectors;
+	uint32_t drive; //bios drive number
+	uint32_t mem_end; //end of the memory above 1MiB, 0 if the loader didn't say
+} boot_info;
+
+//multiboot_info.flags, which fields are valid
+#define MB_INFO_MEMORY 0x001
+#define MB_INFO_BOOTDEV 0x002
+#define MB_INFO_CMDLINE 0x004
+#define MB_INFO_MMAP 0x040
+
+typedef struct {
+	uint32_t flags;
+	uint32_t mem_lower; //KiB below 1MiB
+	uint32_t mem_upper; //KiB from 1MiB up to the first hole
+	uint32_t boot_device; //bios drive in the top byte
+	uint32_t cmdline;
+	uint32_t mods_count;
+	uint32_t mods_addr;
+	uint32_t syms[4];
+	uint32_t mmap_length;
+	uint32_t mmap_addr;
+} multiboot_info;
+
+#define MB_MEMORY_AVAILABLE 1
+
+typedef struct {
+	uint32_t size; //of the entry without this field
+	uint64_t addr;
+	uint64_t len;
+	uint32_t type;
+} __attribute__((packed)) multiboot_mmap;
+
+extern boot_info boot;
+
+//copies what the loader left, first thing in kernel_main since it lives in memory the kernel reuses
+void init_boot(uint32_t magic, void* info);
+
+#endif
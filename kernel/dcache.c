@@ -0,0 +1,191 @@
+#include "dcache.h"
+
+#include "../libc/mem.h"
+#include "../libc/string.h"
+
+typedef struct dentry {
+	void* parent;
+	void* node; //0x0 means negative entry
+	uint32_t hash;
+	struct dentry* hnext; //hash chain
+	struct dentry* lprev; //lru list, head is most recently used
+	struct dentry* lnext;
+	char name[DCACHE_NAME_LEN];
+} dentry;
+
+static dentry dentries[DCACHE_ENTRIES];
+static dentry* buckets[DCACHE_BUCKETS];
+
+static dentry* lru_head = 0x0;
+static dentry* lru_tail = 0x0;
+static uint16_t dentries_used = 0;
+
+typedef struct {
+	void* node;
+	char* path;
+} dpath;
+
+static dpath paths[DCACHE_PATHS];
+static uint8_t path_victim = 0;
+
+//FNV-1a over the name, seeded with the parent address
+static uint32_t dcache_hash(void* parent, char name[])
+{
+	uint32_t h = 2166136261u ^ (uint32_t)parent;
+	while (*name != '\0')
+	{
+		h ^= (uint8_t)*name++;
+		h *= 16777619u;
+	}
+	return h;
+}
+
+static void lru_unlink(dentry* d)
+{
+	if (d->lprev != 0x0) d->lprev->lnext = d->lnext;
+	else lru_head = d->lnext;
+
+	if (d->lnext != 0x0) d->lnext->lprev = d->lprev;
+	else lru_tail = d->lprev;
+
+	d->lprev = 0x0;
+	d->lnext = 0x0;
+}
+
+static void lru_push(dentry* d)
+{
+	d->lprev = 0x0;
+	d->lnext = lru_head;
+	if (lru_head != 0x0) lru_head->lprev = d;
+	lru_head = d;
+	if (lru_tail == 0x0) lru_tail = d;
+}
+
+static void hash_unlink(dentry* d)
+{
+	dentry** link = &buckets[d->hash % DCACHE_BUCKETS];
+	while (*link != 0x0)
+	{
+		if (*link == d)
+		{
+			*link = d->hnext;
+			break;
+		}
+		link = &(*link)->hnext;
+	}
+	d->hnext = 0x0;
+}
+
+static dentry* dcache_find(void* parent, char name[], uint32_t hash)
+{
+	dentry* d = buckets[hash % DCACHE_BUCKETS];
+	while (d != 0x0)
+	{
+		if (d->hash == hash && d->parent == parent && strcmp(d->name, name) == 0)
+			return d;
+		d = d->hnext;
+	}
+	return 0x0;
+}
+
+int dcache_lookup(void* parent, char name[], void** node)
+{
+	dentry* d = dcache_find(parent, name, dcache_hash(parent, name));
+	if (d == 0x0) return DCACHE_MISS;
+
+	if (d != lru_head)
+	{
+		lru_unlink(d);
+		lru_push(d);
+	}
+	*node = d->node;
+	return DCACHE_HIT;
+}
+
+void dcache_insert(void* parent, char name[], void* node)
+{
+	if (strlen(name) >= DCACHE_NAME_LEN) return;
+
+	uint32_t hash = dcache_hash(parent, name);
+	dentry* d = dcache_find(parent, name, hash);
+	if (d != 0x0)
+	{
+		d->node = node;
+		return;
+	}
+
+	if (dentries_used < DCACHE_ENTRIES)
+	{
+		d = &dentries[dentries_used++];
+	}
+	else //recycle the least recently used entry
+	{
+		d = lru_tail;
+		lru_unlink(d);
+		hash_unlink(d);
+	}
+
+	memset(d->name, 0, DCACHE_NAME_LEN);
+	strcpy(name, d->name);
+	d->parent = parent;
+	d->node = node;
+	d->hash = hash;
+
+	d->hnext = buckets[hash % DCACHE_BUCKETS];
+	buckets[hash % DCACHE_BUCKETS] = d;
+	lru_push(d);
+}
+
+void dcache_invalidate(void* parent, char name[])
+{
+	dentry* d = dcache_find(parent, name, dcache_hash(parent, name));
+	if (d == 0x0) return;
+
+	hash_unlink(d);
+	lru_unlink(d);
+
+	//move it to the back so it gets recycled first
+	d->parent = 0x0;
+	d->node = 0x0;
+	d->name[0] = '\0';
+	if (lru_tail != 0x0) lru_tail->lnext = d;
+	d->lprev = lru_tail;
+	lru_tail = d;
+	if (lru_head == 0x0) lru_head = d;
+}
+
+char* dcache_get_path(void* node)
+{
+	for (uint8_t i = 0; i < DCACHE_PATHS; i++)
+	{
+		if (paths[i].node == node && paths[i].path != 0x0) return paths[i].path;
+	}
+	return 0x0;
+}
+
+void dcache_set_path(void* node, char* path)
+{
+	dpath* slot = &paths[path_victim];
+	path_victim = (path_victim + 1) % DCACHE_PATHS;
+
+	kfree(slot->path);
+	slot->node = node;
+	slot->path = path;
+}
+
+void dcache_clear()
+{
+	memset(dentries, 0, sizeof(dentries));
+	memset(buckets, 0, sizeof(buckets));
+	lru_head = 0x0;
+	lru_tail = 0x0;
+	dentries_used = 0;
+
+	for (uint8_t i = 0; i < DCACHE_PATHS; i++)
+	{
+		kfree(paths[i].path);
+		paths[i].node = 0x0;
+		paths[i].path = 0x0;
+	}
+	path_victim = 0;
+}
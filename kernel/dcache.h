@@ -0,0 +1,33 @@
+#ifndef DCACHE_H
+#define DCACHE_H
+
+#include <stdint.h>
+
+/* Path lookup cache (dentry cache)
+maps (parent node, child name) to the child node.
+a node of 0x0 is a negative entry, the name is known to not exist under parent.
+the cache is bounded, the least recently used entry is recycled when full.
+names longer than DCACHE_NAME_LEN - 1 are never cached.
+*/
+
+#define DCACHE_BUCKETS 64
+#define DCACHE_ENTRIES 128
+#define DCACHE_NAME_LEN 24
+
+#define DCACHE_PATHS 8
+
+#define DCACHE_MISS 0
+#define DCACHE_HIT 1
+
+//returns DCACHE_HIT and sets *node on a hit (*node is 0x0 for negative entries)
+int dcache_lookup(void* parent, char name[], void** node);
+void dcache_insert(void* parent, char name[], void* node);
+void dcache_invalidate(void* parent, char name[]);
+
+//rendered forward paths ("/a/b/c"), the cache owns the strings
+char* dcache_get_path(void* node);
+void dcache_set_path(void* node, char* path);
+
+void dcache_clear();
+
+#endif
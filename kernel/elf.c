@@ -0,0 +1,124 @@
+#include "elf.h"
+#include "filesystem.h"
+#include "vm.h"
+
+#include "../drivers/screen.h"
+#include "../libc/mem.h"
+
+static void elf_error(char* msg)
+{
+	kprint_color(RED_TEXT);
+	kprint(msg);
+	kprint_color(WHITE_ON_BLACK);
+}
+
+//checks the header and the segments, the program headers have to be in the first page
+static char* elf_check(uint8_t* page, uint32_t size)
+{
+	elf32_ehdr* eh = (elf32_ehdr*)page;
+	if (size < sizeof(elf32_ehdr) || eh->e_ident[0] != 0x7f || eh->e_ident[1] != 'E' || eh->e_ident[2] != 'L' || eh->e_ident[3] != 'F')
+		return "Not an ELF file.\n";
+	if (eh->e_ident[4] != 1 || eh->e_type != ET_EXEC || eh->e_machine != EM_386)
+		return "Not a 32 bit x86 executable.\n";
+	//every term on its own, sums of file fields can wrap
+	if (eh->e_phentsize != sizeof(elf32_phdr) || eh->e_phoff > PCACHE_PAGE_SIZE || eh->e_phnum > (PCACHE_PAGE_SIZE - eh->e_phoff) / sizeof(elf32_phdr))
+		return "Program headers aren't in the first page.\n";
+
+	elf32_phdr* ph = (elf32_phdr*)(page + eh->e_phoff);
+	for (uint16_t i = 0; i < eh->e_phnum; i++)
+	{
+		if (ph[i].p_type != PT_LOAD) continue;
+		if (ph[i].p_vaddr < USER_BASE || ph[i].p_vaddr > VM_STACK_TOP - VM_STACK_SIZE || ph[i].p_memsz > VM_STACK_TOP - VM_STACK_SIZE - ph[i].p_vaddr || ph[i].p_filesz > ph[i].p_memsz)
+			return "Segment outside the user window.\n";
+		if (ph[i].p_offset % PAGE_SIZE != ph[i].p_vaddr % PAGE_SIZE || ph[i].p_offset > size || ph[i].p_filesz > size - ph[i].p_offset)
+			return "Segment doesn't line up with the file.\n";
+	}
+	return 0x0;
+}
+
+static vm_space* elf_load(fs_index file, uint32_t* entry)
+{
+	uint32_t size = fs_size(file);
+	pcache_page* page = fs_map(file, 0);
+	if (page == 0x0)
+	{
+		elf_error("Can't read the file.\n");
+		return 0x0;
+	}
+
+	char* err = elf_check(page->data, size);
+	if (err != 0x0)
+	{
+		pcache_put(page);
+		elf_error(err);
+		return 0x0;
+	}
+
+	vm_space* vm = vm_create(file);
+	if (vm == 0x0)
+	{
+		pcache_put(page);
+		elf_error(paging_enabled() ? "Out of memory.\n" : "No paging on this cpu.\n");
+		return 0x0;
+	}
+
+	elf32_ehdr* eh = (elf32_ehdr*)page->data;
+	elf32_phdr* ph = (elf32_phdr*)(page->data + eh->e_phoff);
+	int ok = 1;
+	for (uint16_t i = 0; i < eh->e_phnum && ok; i++)
+	{
+		if (ph[i].p_type != PT_LOAD || ph[i].p_memsz == 0) continue;
+
+		//areas start on a page, the file offset moves down with it
+		uint32_t start = ph[i].p_vaddr & PAGE_MASK;
+		uint32_t end = (ph[i].p_vaddr + ph[i].p_memsz + PAGE_SIZE - 1) & PAGE_MASK;
+		uint32_t offset = ph[i].p_offset & PAGE_MASK;
+		uint8_t flags = VM_FILE | ((ph[i].p_flags & PF_W) ? VM_WRITE : 0);
+		uint32_t file_end = ph[i].p_vaddr + ph[i].p_filesz;
+		//read only without bss, the last page can be the file's too and be shared
+		if (!(flags & VM_WRITE) && ph[i].p_filesz == ph[i].p_memsz) file_end = end;
+		ok = vm_add_area(vm, start, end, offset, file_end, flags);
+	}
+	if (ok) ok = vm_add_area(vm, VM_STACK_TOP - VM_STACK_SIZE, VM_STACK_TOP, 0, 0, VM_WRITE);
+
+	*entry = eh->e_entry;
+	pcache_put(page);
+	if (!ok)
+	{
+		vm_destroy(vm);
+		elf_error("Overlapping or too many segments.\n");
+		return 0x0;
+	}
+	return vm;
+}
+
+thread* elf_run(char path[], uint8_t priority)
+{
+	mutex_lock(&fs_lock);
+	fs_index file = fs_open(path);
+	if (file == FS_NONE)
+	{
+		mutex_unlock(&fs_lock);
+		no_such_file();
+		return 0x0;
+	}
+
+	uint32_t entry;
+	vm_space* vm = elf_load(file, &entry);
+	mutex_unlock(&fs_lock);
+	if (vm == 0x0) return 0x0;
+
+	char* name = path;
+	for (char* c = path; *c != '\0'; c++)
+	{
+		if (*c == '/') name = c + 1;
+	}
+
+	thread* t = thread_create_process(name, priority, entry, VM_STACK_TOP, vm);
+	if (t == 0x0)
+	{
+		vm_destroy(vm);
+		elf_error("No free thread.\n");
+	}
+	return t;
+}
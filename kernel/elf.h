@@ -0,0 +1,52 @@
+#ifndef ELF_H
+#define ELF_H
+
+#include <stdint.h>
+#include "sched.h"
+
+/* ELF programs
+statically linked 32 bit executables from the filesystem, run in ring 3 in an address space of their own (kernel/vm.h).
+loading only reads the headers, the segments are paged in as the program touches them,
+so a program starts in the same time whatever its size.
+the segments have to be in the user window (USER_BASE) and their file offsets page aligned like their addresses
+(ld does that with -z max-page-size=4096, see tools/hello.elf in the Makefile).
+*/
+
+#define EI_NIDENT 16
+#define ET_EXEC 2
+#define EM_386 3
+#define PT_LOAD 1
+#define PF_W 0x2
+
+typedef struct {
+	uint8_t e_ident[EI_NIDENT];
+	uint16_t e_type;
+	uint16_t e_machine;
+	uint32_t e_version;
+	uint32_t e_entry;
+	uint32_t e_phoff;
+	uint32_t e_shoff;
+	uint32_t e_flags;
+	uint16_t e_ehsize;
+	uint16_t e_phentsize;
+	uint16_t e_phnum;
+	uint16_t e_shentsize;
+	uint16_t e_shnum;
+	uint16_t e_shstrndx;
+} elf32_ehdr;
+
+typedef struct {
+	uint32_t p_type;
+	uint32_t p_offset;
+	uint32_t p_vaddr;
+	uint32_t p_paddr;
+	uint32_t p_filesz;
+	uint32_t p_memsz;
+	uint32_t p_flags;
+	uint32_t p_align;
+} elf32_phdr;
+
+//starts the program in a thread named after the file, 0x0 (and a message why) if it can't run
+thread* elf_run(char path[], uint8_t priority);
+
+#endif
@@ -1,15 +1,20 @@
 #include "filesystem.h"
+#include "dcache.h"
+#include "pcache.h"
+#include "vm.h"
+#include "jfs.h"
 
 #include "../libc/mem.h"
 #include "../libc/string.h"
+#include "../libc/crc32.h"
+#include "../libc/lz.h"
 #include "../drivers/ata.h"
 #include "../drivers/screen.h"
 
-#define FS_TABLE_SECTORS 4
-
 //we wil be using relative lba (starting at kernel_end)
-const uint16_t kernel_end = 48; //this is a constant predefined value in bootsect.asm + 1
-const uint16_t fs_begin = kernel_end + FS_TABLE_SECTORS; // 4 sectors are reserved for fs table
+uint32_t kernel_end = 0; //the loader says where the kernel ends (kernel/boot.h)
+
+uint32_t fs_next_free = 0; //file data is allocated upwards from the end of the fs table (see jfs.h)
 
 /* JFS (Jesse File System)
 
@@ -31,143 +36,372 @@ f1 second byte is lba of file (uint32_t)
 f1 next 4 bytes is the file size in bytes (uint32_t)
 f1 next n bytes is file name (ptr to str on heap)
 //file size in bytes can be used to get sector count
+//files own a power of two number of pages (see fs_cap_pages), growing past it moves the file
+//f1 | 0x80 is a packed (compressed) file, its record has the extent size in sectors after the file size (see jfs.h)
+//packed files are rewritten whole into a fresh extent whenever they have dirty pages on fsflush
 
 f2 - f255 currently undefined
 
 // JFS table (on heap)
-The heap implementation is similar but has a few differences
-the first being that the size will not always be 512 * 4 bytes
-the second being that instead of offsets, addresses are used (uint32_t)
-the third is that the address of the parent is stored in the child (uint32_t) (as the 2nd element)
-the fourth being that root is marked as a folder instead of nothing (uint8_t)
+The heap implementation is a flat pool of fixed size nodes (fs_node)
+nodes live in chunks of FS_CHUNK_NODES so their addresses never move
+nodes refer to each other with 16 bit indices (fs_index) instead of pointers
+root is always node 0 and is marked as a folder
+folders keep their children in one contiguous fs_index array
+names shorter than FS_INLINE_NAME are stored inside the node, longer ones on the heap
 the heap table is initialized using the disk table
-
-the tree can be navigated using a byte array.
-each byte represents which child to go to.
-if a child does not exist (parent is file or folder doesn't span that far)
-then the parent is returned (ex. 0x00 0xff would only take you into the first child of root)
-root can technically be accessed with 0xff but that won't work if root has 255 children.
-instead root() can be used
 */
 
+#define FS_LONG_NAME 0x01 //name is on the heap instead of inline
+//FS_PACKED (0x80) marks packed files, same bit as on disk
+
+#define FS_DIR_PAGE 0xFFFFFFFF //page index of the packed file directory in the page cache
+
+#define FS_INLINE_NAME 16
+#define FS_CHUNK_NODES 64
+#define FS_MAX_CHUNKS (FS_MAX_NODES / FS_CHUNK_NODES)
+
+//32 bytes, two nodes per cache line
 typedef struct {
 	uint8_t type;
-	void* parent; //should be hfolder* but oh well
-	uint8_t childCnt;
-	char* name;
-	void** children; //pointer to array of children pointers
-} __attribute__((packed)) hfolder;
+	uint8_t flags;
+	union {
+		uint16_t childCnt; //FS_FOLDER
+		uint16_t sectors; //FS_FILE, extent size of a packed file
+	};
+	fs_index parent;
+	fs_index self;
+	union {
+		fs_index* children; //FS_FOLDER
+		struct {
+			uint32_t lba;
+			uint32_t size; //bytes NOT sectors
+		} file; //FS_FILE
+	};
+	union {
+		char name[FS_INLINE_NAME];
+		char* long_name;
+	};
+} fs_node;
 
-hfolder* fs_root;
-hfolder* fs_current;
+fs_node* fs_chunks[FS_MAX_CHUNKS];
+uint16_t fs_node_count = 0;
 
-void create_folder(char name[])
+fs_node* fs_root;
+fs_node* fs_current;
+
+mutex fs_lock;
+
+static inline fs_node* node_at(fs_index idx)
+{
+	return fs_chunks[idx / FS_CHUNK_NODES] + (idx % FS_CHUNK_NODES);
+}
+
+static inline fs_node* node_child(fs_node* folder, uint16_t i)
+{
+	return node_at(folder->children[i]);
+}
+
+static inline fs_node* node_parent(fs_node* node)
 {
-	int namel = strlen(name) + 1;
-	char* pname = kmalloc(namel);
-	strcpy(name, pname);
+	return node->parent == FS_NONE ? 0x0 : node_at(node->parent);
+}
+
+static inline char* node_name(fs_node* node)
+{
+	return (node->flags & FS_LONG_NAME) ? node->long_name : node->name;
+}
+
+//hands out a zeroed node, returns FS_NONE if the pool is exhausted
+fs_index alloc_node(uint8_t type, fs_index parent)
+{
+	uint16_t chunk = fs_node_count / FS_CHUNK_NODES;
+	if (chunk >= FS_MAX_CHUNKS) return FS_NONE;
 	
-	hfolder* newfolder = kmalloc(sizeof(hfolder));
-	newfolder->type = 0;
-	newfolder->childCnt = 0;
-	newfolder->name = pname;
+	if (fs_chunks[chunk] == 0x0)
+	{
+		//keep every node on a 32 byte boundary so none straddles a cache line
+		void* raw = kmalloc(sizeof(fs_node) * FS_CHUNK_NODES + 31);
+		fs_chunks[chunk] = (fs_node*)(((uint32_t)raw + 31) & ~31);
+	}
+	
+	fs_index idx = fs_node_count++;
+	fs_node* node = node_at(idx);
+	memset(node, 0, sizeof(fs_node));
+	node->type = type;
+	node->parent = parent;
+	node->self = idx;
+	return idx;
+}
+
+void set_node_name(fs_node* node, char name[])
+{
+	int nlen = strlen(name) + 1;
+	if (nlen <= FS_INLINE_NAME)
+	{
+		memcpy(name, node->name, nlen);
+		return;
+	}
+	
+	node->flags |= FS_LONG_NAME;
+	node->long_name = kmalloc(nlen);
+	memcpy(name, node->long_name, nlen);
+}
+
+//children arrays hold 4 entries and then double, so they only grow when full
+void add_child(fs_node* folder, fs_index child)
+{
+	uint16_t cnt = folder->childCnt;
+	if (cnt == 0)
+	{
+		folder->children = kmalloc(sizeof(fs_index) * 4);
+	}
+	else if (cnt >= 4 && (cnt & (cnt - 1)) == 0)
+	{
+		folder->children = krealloc(folder->children, sizeof(fs_index) * cnt * 2);
+	}
+	folder->children[folder->childCnt++] = child;
+}
+
+//returns every node to the pool, chunks are kept for reuse
+void free_nodes()
+{
+	for (fs_index i = 0; i < fs_node_count; i++)
+	{
+		fs_node* node = node_at(i);
+		if (node->flags & FS_LONG_NAME) kfree(node->long_name);
+		if (node->type == FS_FOLDER) kfree(node->children);
+	}
+	fs_node_count = 0;
+}
+
+fs_node* create_node(uint8_t type, char name[])
+{
+	if (fs_current->childCnt >= FS_MAX_CHILDREN)
+	{
+		kprint_color(RED_TEXT);
+		kprint("Folder is full.\n");
+		kprint_color(WHITE_ON_BLACK);
+		return 0x0;
+	}
 	
-	uint8_t oFolderCnt = fs_current->childCnt;
-	void** resizedChilds = krealloc(fs_current->children, sizeof(void*) * (oFolderCnt + 1)); //add 4 bytes to parent
+	fs_index idx = alloc_node(type, fs_current->self);
+	if (idx == FS_NONE)
+	{
+		kprint_color(RED_TEXT);
+		kprint("Out of filesystem nodes.\n");
+		kprint_color(WHITE_ON_BLACK);
+		return 0x0;
+	}
 	
-	newfolder->parent = fs_current;
+	fs_node* node = node_at(idx);
+	set_node_name(node, name);
 	
-	resizedChilds[oFolderCnt] = newfolder;
-	fs_current->childCnt += 1;
+	add_child(fs_current, idx);
 	
-	fs_current->children = resizedChilds;
+	dcache_invalidate(fs_current, node_name(node)); //may have been cached as missing
+	return node;
 }
 
-uint16_t save_node(void* node, void* buffer)
+void create_folder(char name[])
+{
+	create_node(FS_FOLDER, name);
+}
+
+void create_file(char name[])
 {
-	uint8_t type = *(uint8_t*)(node);
-	*(uint8_t*)(buffer) = type;
+	create_node(FS_FILE, name);
+}
+
+//writes the record of a single node at buffer + off, children offsets are filled in later
+//returns the size of the record or 0 if it doesn't fit in the table
+uint16_t save_node(fs_node* node, void* buffer, uint16_t off)
+{
+	char* name = node_name(node);
+	int nlen = strlen(name) + 1;
+	uint8_t packed = node->type == FS_FILE && (node->flags & FS_PACKED);
+	uint32_t header = node->type == FS_FOLDER ? FS_FOLDER_HEADER : (packed ? FS_PACKED_HEADER : FS_FILE_HEADER);
+	uint32_t size = header + nlen + (node->type == FS_FOLDER ? node->childCnt * 2 : 0);
+	if (off + size > FS_TABLE_DATA) return 0;
 	
-	switch (type) //ah yes "polymorphism"
+	buffer += off;
+	*(uint8_t*)(buffer) = node->type | (packed ? FS_PACKED : 0);
+	switch (node->type)
 	{
-		case 0:
+		case FS_FOLDER:
 		{
-			hfolder* fnode = (hfolder*)node;
-			uint8_t childrenNum = fnode->childCnt;
-			*(uint8_t*)(buffer + 1) = childrenNum;
-			
-			int nlen = strlen(fnode->name) + 1;
-			
-			strcpy(fnode->name, buffer+2);
-			
-			uint16_t coff = 2 + nlen + childrenNum*2;
-			
-			for (uint16_t i = 0; i < childrenNum; i++)
-			{
-				*(uint16_t*)(buffer + 2 + nlen + i*2) = coff;
-				void* child = fnode->children[i];
-				
-				coff += save_node(child, buffer + coff);
-			}
-			return coff;
-			
+			*(uint8_t*)(buffer + 1) = node->childCnt;
+			memcpy(name, buffer + FS_FOLDER_HEADER, nlen);
+			break;
 		}
-		case 1:
+		case FS_FILE:
 		{
-		/* @TODO
-			*(uint32_t*)(buffer + 1) = *(uint32_t*)(node + 5);
-			*(uint32_t*)(buffer + 5) = *(uint32_t*)(node + 9);
-			
-			uint16_t nlen = strlen((char*)(node + 13)) + 1;
-			strcpy((char*)*(uint32_t*)(node+13), buffer+9);
-			return nlen + 9;
-			*/
+			*(uint32_t*)(buffer + 1) = node->file.lba;
+			*(uint32_t*)(buffer + 5) = node->file.size;
+			if (packed) *(uint32_t*)(buffer + 9) = node->sectors;
+			memcpy(name, buffer + header, nlen);
+			break;
 		}
 	}
+	return size;
 }
 
+//one folder being walked by save_tree/load_tree
+typedef struct {
+	fs_node* node;
+	uint16_t start; //table offset of the folder record, child offsets are relative to it
+	uint16_t offsets; //table offset of the child offset array
+	uint16_t next; //next child to visit
+	uint16_t count;
+} fs_frame;
+
+//serializes the tree in pre-order without recursing so deep trees can't overflow the stack
+//returns the used table size or 0 if the tree doesn't fit
+uint16_t save_tree(void* buffer)
+{
+	fs_frame* stack = kmalloc(sizeof(fs_frame) * fs_node_count);
+	uint16_t sp = 0;
+	
+	uint8_t childrenNum = fs_root->childCnt;
+	*(uint8_t*)(buffer) = childrenNum;
+	uint16_t coff = FS_ROOT_HEADER + childrenNum*2;
+	
+	stack[sp++] = (fs_frame){ fs_root, 0, FS_ROOT_HEADER, 0, childrenNum };
+	while (sp > 0)
+	{
+		fs_frame* f = &stack[sp - 1];
+		if (f->next == f->count)
+		{
+			sp--;
+			continue;
+		}
+		
+		fs_node* child = node_child(f->node, f->next);
+		*(uint16_t*)(buffer + f->offsets + f->next*2) = coff - f->start;
+		f->next++;
+		
+		uint16_t size = save_node(child, buffer, coff);
+		if (size == 0)
+		{
+			coff = 0;
+			break;
+		}
+		
+		if (child->type == FS_FOLDER)
+		{
+			uint16_t offsets = coff + FS_FOLDER_HEADER + strlen(node_name(child)) + 1;
+			stack[sp++] = (fs_frame){ child, coff, offsets, 0, child->childCnt };
+		}
+		coff += size;
+	}
+	
+	kfree(stack);
+	return coff;
+}
+
+//fills in the checksum trailer (see jfs.h)
+void seal_table(void* buffer)
+{
+	uint32_t* trailer = buffer + FS_TABLE_DATA;
+	trailer[0] = FS_TABLE_MAGIC;
+	for (uint16_t i = 0; i < FS_TABLE_SECTORS; i++)
+	{
+		uint32_t len = i == FS_TABLE_SECTORS - 1 ? FS_SECTOR_SIZE - FS_TRAILER_SIZE : FS_SECTOR_SIZE;
+		trailer[1 + i] = crc32c(0, buffer + i * FS_SECTOR_SIZE, len);
+	}
+}
+
+//returns the first sector whose checksum doesn't match or -1 if the table is fine
+int check_table(void* buffer)
+{
+	uint32_t* trailer = buffer + FS_TABLE_DATA;
+	if (trailer[0] != FS_TABLE_MAGIC) return -1; //blank or older table, nothing to check
+	
+	for (uint16_t i = 0; i < FS_TABLE_SECTORS; i++)
+	{
+		uint32_t len = i == FS_TABLE_SECTORS - 1 ? FS_SECTOR_SIZE - FS_TRAILER_SIZE : FS_SECTOR_SIZE;
+		if (trailer[1 + i] != crc32c(0, buffer + i * FS_SECTOR_SIZE, len)) return i;
+	}
+	return -1;
+}
+
+void pack_file(fs_node* node);
+
 void save_state()
 {
+	if (kernel_end == 0)
+	{
+		no_filesystem();
+		return;
+	}
+	
 	//step one: allocate buffer	
-	//assume that the tree won't exceed the reserved size
-	void* buffer = kmalloc(512 * FS_TABLE_SECTORS); 
+	void* buffer = kmalloc(FS_TABLE_SIZE); 
 
 	//step two: write data
-	uint8_t childrenNum = fs_root->childCnt;
-	*(uint8_t*)(buffer) = childrenNum;
-				
-	uint16_t coff = 1 + childrenNum*2;
-			
-	for (uint16_t i = 0; i < childrenNum; i++)
+	//packed files move on every rewrite, so they have to be packed before their records are written
+	for (fs_index i = 0; i < fs_node_count; i++)
 	{
-		*(uint16_t*)(buffer + 1 + i*2) = coff;
-		void* child = fs_root->children[i];
-				
-		coff += save_node(child, buffer + coff);
+		fs_node* node = node_at(i);
+		if (node->type == FS_FILE && (node->flags & FS_PACKED) && pcache_file_dirty(i)) pack_file(node);
 	}
 	
-	//step three: flush buffer
+	if (save_tree(buffer) == 0)
+	{
+		kprint_color(RED_TEXT);
+		kprint("Filesystem table is full, nothing was saved.\n");
+		kprint_color(WHITE_ON_BLACK);
+		kfree(buffer);
+		return;
+	}
+	
+	//step three: flush file contents and buffer
+	seal_table(buffer);
+	pcache_writeback();
 	lba_write(kernel_end, FS_TABLE_SECTORS, buffer);
 	
 	//step four: free buffer
 	kfree(buffer);
 }
 
-void ls()
+//renders the forward path of a folder ("/a/b/c"), the result is owned by the dcache
+char* fs_path(fs_node* folder)
 {
-	kprint("Currently in ");
-	kprint_color(LBLUE_TEXT);
+	char* path = dcache_get_path(folder);
+	if (path != 0x0) return path;
 	
-	kprint(fs_current->name);
+	uint16_t len = 0;
+	for (fs_node* f = folder; f != fs_root; f = node_parent(f))
+	{
+		len += strlen(node_name(f)) + 1;
+	}
+	if (len == 0) len = 1; //root is just "/"
+	
+	path = kmalloc(len + 1);
+	path[0] = '/';
+	path[len] = '\0';
 	
-	hfolder* parent = fs_current->parent;
-	while (parent != 0x0) //Yes, the full path is reversed
+	uint16_t end = len;
+	for (fs_node* f = folder; f != fs_root; f = node_parent(f))
 	{
-		kprint("-");
-		kprint(parent->name);
-		parent = parent->parent;
+		char* name = node_name(f);
+		int nlen = strlen(name);
+		end -= nlen;
+		memcpy(name, path + end, nlen);
+		path[--end] = '/';
 	}
 	
+	dcache_set_path(folder, path);
+	return path;
+}
+
+void ls()
+{
+	kprint("Currently in ");
+	kprint_color(LBLUE_TEXT);
+	
+	kprint(fs_path(fs_current));
+	
 	kprint(".\n");
 	
 	uint8_t children = fs_current->childCnt;
@@ -179,156 +413,557 @@ void ls()
 	
 	for (uint16_t i = 0; i < children; i++)
 	{
-		char idx[4] = "";
-		int_to_ascii(i, idx);
-		kprint(idx);
-		kprint(": ");
+		fs_node* child = node_child(fs_current, i);
+		if (child->type == FS_FILE && (child->flags & FS_PACKED))
+		{
+			//stored size as a percentage of the file size
+			uint32_t ratio = child->file.size ? (uint32_t)child->sectors * FS_SECTOR_SIZE * 100 / child->file.size : 0;
+			kprintf("%u: %s [lz %u%%]    ", i, node_name(child), ratio);
+		}
+		else
+		{
+			kprintf("%u: %s    ", i, node_name(child));
+		}
+	}
+	kprint_color(WHITE_ON_BLACK);
+	kprint("\n");
+}
+
+//finds a direct child by name, results (including misses) go through the dcache
+fs_node* lookup_child(fs_node* folder, char name[])
+{
+	void* node;
+	if (dcache_lookup(folder, name, &node) == DCACHE_HIT) return node;
+	
+	node = 0x0;
+	uint8_t children = folder->childCnt;
+	for (uint16_t i = 0; i < children; i++)
+	{
+		fs_node* child = node_child(folder, i);
+		if (strcmp(node_name(child), name) == 0)
+		{
+			node = child;
+			break;
+		}
+	}
+	
+	dcache_insert(folder, name, node);
+	return node;
+}
+
+//resolves an absolute ("/a/b") or relative ("a/../b") path to a folder
+//returns 0x0 if any component doesn't exist or isn't a folder
+fs_node* resolve_path(char path[])
+{
+	fs_node* folder = fs_current;
+	if (*path == '/')
+	{
+		folder = fs_root;
+		path++;
+	}
+	
+	while (*path != '\0')
+	{
+		char* end = path;
+		while (*end != '/' && *end != '\0') end++;
 		
-		void* child = fs_current->children[i];
+		char sep = *end;
+		*end = '\0'; //temporarily terminate the component
 		
-		uint8_t childtype = *(uint8_t*)(child);
-		switch (childtype)
+		if (strcmp(path, "..") == 0)
 		{
-			case 0:
-			{
-				hfolder* fc = (hfolder*)child;
-				kprint(fc->name);
-				break;
-			}
-			case 1:
-			{
-				kprint(child + 13);
-				break;
-			}
+			if (folder != fs_root) folder = node_parent(folder);
+		}
+		else if (*path != '\0' && strcmp(path, ".") != 0)
+		{
+			folder = lookup_child(folder, path);
 		}
 		
-		kprint("    ");
+		*end = sep;
+		if (folder == 0x0 || folder->type != FS_FOLDER) return 0x0;
+		
+		path = end;
+		if (*path == '/') path++;
 	}
-	kprint_color(WHITE_ON_BLACK);
-	kprint("\n");
+	return folder;
 }
 
 void cd(char dir[])
 {
-	if (strcmp(dir, "..") == 0 && fs_current != fs_root)
+	fs_node* folder = resolve_path(dir);
+	if (folder != 0x0)
 	{
-		fs_current = fs_current->parent;
+		fs_current = folder;
 		return;
 	}
-
+	
 	uint8_t children = fs_current->childCnt;
-	for (uint16_t i = 0; i < children; i++)
+	int idx = (*dir >= '0' && *dir <= '9') ? stoi(dir) : -1;
+	if (idx >= children || idx < 0 || node_child(fs_current, idx)->type != FS_FOLDER)
+	{
+		kprint_color(RED_TEXT);
+		kprint("No such directory.\n");
+		kprint_color(WHITE_ON_BLACK);
+		return;
+	}
+	
+	fs_current = node_child(fs_current, idx);
+}
+
+//resolves a path to a file, returns FS_NONE if it doesn't exist
+fs_index fs_open(char path[])
+{
+	fs_node* folder = fs_current;
+	char* name = path;
+	
+	char* slash = 0x0;
+	for (char* c = path; *c != '\0'; c++)
+	{
+		if (*c == '/') slash = c;
+	}
+	
+	if (slash != 0x0)
+	{
+		name = slash + 1;
+		*slash = '\0';
+		folder = (slash == path) ? fs_root : resolve_path(path);
+		*slash = '/';
+		if (folder == 0x0) return FS_NONE;
+	}
+	
+	fs_node* file = lookup_child(folder, name);
+	if (file == 0x0 || file->type != FS_FILE) return FS_NONE;
+	return file->self;
+}
+
+uint32_t fs_size(fs_index file)
+{
+	return node_at(file)->file.size;
+}
+
+//decompresses page index of a packed file into dst
+void unpack_page(fs_node* node, uint32_t index, uint8_t* dst)
+{
+	if (node->file.lba == 0) return;
+	
+	pcache_page* dirpage = pcache_get(node->self, FS_DIR_PAGE, node->file.lba);
+	if (dirpage == 0x0) return;
+	
+	uint16_t* dir = (uint16_t*)dirpage->data;
+	uint32_t pages = dir[0];
+	if (index >= pages) //written past the end after the last pack, still zeros
 	{
+		pcache_put(dirpage);
+		return;
+	}
+	
+	uint32_t lba = node->file.lba + fs_pack_dir_sectors(pages);
+	for (uint32_t i = 0; i < index; i++) lba += fs_pack_sectors(dir[1 + i]);
+	uint32_t len = dir[1 + index];
+	pcache_put(dirpage);
+	
+	if (len >= FS_PAGE_SIZE)
+	{
+		lba_read(lba, FS_PAGE_SECTORS, dst);
+		return;
+	}
+	
+	uint8_t* bounce = kmalloc(FS_PAGE_SIZE);
+	lba_read(lba, fs_pack_sectors(len), bounce);
+	if (lz_decompress(bounce, len, dst, FS_PAGE_SIZE) < 0)
+	{
+		memset(dst, 0, FS_PAGE_SIZE);
+		kprint_color(RED_TEXT);
+		kprintf("Corrupt compressed page in %s.\n", node_name(node));
+		kprint_color(WHITE_ON_BLACK);
+	}
+	kfree(bounce);
+}
+
+//borrows a page of the file from the page cache, give it back with pcache_put
+pcache_page* fs_map(fs_index file, uint32_t page)
+{
+	fs_node* node = node_at(file);
+	if (node->flags & FS_PACKED)
+	{
+		pcache_page* p = pcache_find(file, page);
+		if (p != 0x0) return p;
+		
+		p = pcache_get(file, page, 0);
+		if (p != 0x0) unpack_page(node, page, p->data);
+		return p;
+	}
+	
+	uint32_t lba = 0;
+	if (node->file.lba != 0 && page < fs_cap_pages(node->file.size))
+		lba = node->file.lba + page * FS_PAGE_SECTORS;
+	
+	return pcache_get(file, page, lba);
+}
+
+//1 if sectors more fit on the disk after fs_next_free
+static int disk_room(uint32_t sectors)
+{
+	return kernel_end != 0 && fs_next_free <= ata_sectors && sectors <= ata_sectors - fs_next_free;
+}
 
-		hfolder* child = fs_current->children[i];
-		uint8_t childtype = child->type;
-		if(childtype == 0 && strcmp(child->name, dir) == 0)
+//moves the file to a fresh extent big enough for size bytes, 0 if the disk has no room for it
+//the old extent isn't reused (there is no free space tracking yet)
+int grow_file(fs_node* node, uint32_t size)
+{
+	uint32_t oldpages = fs_cap_pages(node->file.size);
+	uint32_t oldlba = node->file.lba;
+	
+	uint32_t sectors = fs_cap_pages(size) * FS_PAGE_SECTORS;
+	if (!disk_room(sectors)) return 0;
+	uint32_t newlba = fs_next_free;
+	fs_next_free += sectors;
+	
+	if (oldlba != 0 && oldpages != 0)
+	{
+		//cached pages may be newer than the disk so they go first
+		pcache_writeback_file(node->self);
+		
+		uint8_t* bounce = kmalloc(PCACHE_PAGE_SIZE);
+		for (uint32_t i = 0; i < oldpages; i++)
 		{
-			fs_current = child;
-			return;
+			lba_read(oldlba + i * FS_PAGE_SECTORS, FS_PAGE_SECTORS, bounce);
+			lba_write(newlba + i * FS_PAGE_SECTORS, FS_PAGE_SECTORS, bounce);
 		}
+		kfree(bounce);
 	}
 	
-	int idx = stoi(dir);
-	if (idx >= children || idx < 0)
+	node->file.lba = newlba;
+	pcache_rebase(node->self, newlba);
+	return 1;
+}
+
+//rewrites the whole file compressed into a fresh extent, one page at a time
+//works for plain and packed files, the old extent isn't reused (like grow_file)
+void pack_file(fs_node* node)
+{
+	uint32_t pages = (node->file.size + FS_PAGE_SIZE - 1) / FS_PAGE_SIZE;
+	if (pages > FS_PACK_MAX_PAGES)
 	{
 		kprint_color(RED_TEXT);
-		kprint("No such directory.\n");
+		kprint("File is too big to compress.\n");
+		kprint_color(WHITE_ON_BLACK);
+		return;
+	}
+	if (vm_maps(node->self))
+	{
+		file_in_use();
+		return;
+	}
+	
+	uint32_t dirsectors = fs_pack_dir_sectors(pages);
+	if (!disk_room(dirsectors + pages * FS_PAGE_SECTORS)) //pages that don't compress are stored whole
+	{
+		kprint_color(RED_TEXT);
+		kprint("Disk is full.\n");
 		kprint_color(WHITE_ON_BLACK);
 		return;
 	}
+	uint16_t* dir = kmalloc(dirsectors * FS_SECTOR_SIZE);
+	memset(dir, 0, dirsectors * FS_SECTOR_SIZE);
+	dir[0] = pages;
 	
-	fs_current = fs_current->children[idx];
+	uint8_t* out = kmalloc(FS_PAGE_SIZE);
+	uint32_t lba = fs_next_free;
+	uint32_t pos = lba + dirsectors;
+	for (uint32_t i = 0; i < pages; i++)
+	{
+		pcache_page* page = fs_map(node->self, i);
+		if (page == 0x0) //can't happen outside of a leak, the old extent stays valid
+		{
+			kfree(out);
+			kfree(dir);
+			return;
+		}
+		
+		//only worth it when it saves at least a sector
+		uint32_t len = lz_compress(page->data, FS_PAGE_SIZE, out, FS_PAGE_SIZE - FS_SECTOR_SIZE);
+		if (len == 0)
+		{
+			memcpy(page->data, out, FS_PAGE_SIZE);
+			len = FS_PAGE_SIZE;
+		}
+		pcache_put(page);
+		
+		uint32_t sectors = fs_pack_sectors(len);
+		memset(out + len, 0, sectors * FS_SECTOR_SIZE - len);
+		lba_write(pos, sectors, out);
+		pos += sectors;
+		dir[1 + i] = len;
+	}
+	lba_write(lba, dirsectors, (uint8_t*)dir);
+	fs_next_free = pos;
+	
+	pcache_detach(node->self);
+	
+	//a cached directory would still describe the old extent
+	pcache_page* dirpage = pcache_find(node->self, FS_DIR_PAGE);
+	if (dirpage != 0x0)
+	{
+		memcpy(dir, dirpage->data, dirsectors * FS_SECTOR_SIZE);
+		pcache_put(dirpage);
+	}
+	
+	node->file.lba = lba;
+	node->sectors = pos - lba;
+	node->flags |= FS_PACKED;
+	
+	kfree(out);
+	kfree(dir);
 }
 
-void* alloc_name(void* loc)
+//copies data into the page cache, it reaches the disk on the next fsflush
+uint32_t fs_write(fs_index file, uint32_t offset, void* data, uint32_t len)
 {
-	int namelen = strlen(loc) + 1;
-	void* nameloc = kmalloc(namelen);
-	strcpy(loc, nameloc);
-	return nameloc;
+	//the program's shared text would change under it
+	if (vm_maps(file)) return 0;
+
+	fs_node* node = node_at(file);
+	uint32_t end = offset + len;
+	uint8_t packed = node->flags & FS_PACKED; //these are placed on fsflush instead
+	if (!packed && (node->file.lba == 0 || fs_cap_pages(end) > fs_cap_pages(node->file.size)))
+	{
+		if (!grow_file(node, end)) return 0;
+	}
+	
+	//written pages of packed files stay in the cache until the next pack, so the whole write has to fit
+	//one more for the pack directory unpack_page reads
+	if (packed && len != 0)
+	{
+		uint32_t need = (end - 1) / PCACHE_PAGE_SIZE - offset / PCACHE_PAGE_SIZE + 2;
+		if (need > pcache_room() && pcache_file_dirty(file)) pack_file(node); //its dirty pages become clean
+		if (need > pcache_room()) return 0;
+	}
+	
+	uint32_t done = 0;
+	while (done < len)
+	{
+		uint32_t pos = offset + done;
+		pcache_page* page = fs_map(file, pos / PCACHE_PAGE_SIZE);
+		if (page == 0x0) break;
+		
+		uint32_t poff = pos % PCACHE_PAGE_SIZE;
+		uint32_t n = PCACHE_PAGE_SIZE - poff;
+		if (n > len - done) n = len - done;
+		
+		memcpy(data + done, page->data + poff, n);
+		pcache_dirty(page);
+		pcache_put(page);
+		done += n;
+	}
+	
+	if (offset + done > node->file.size) node->file.size = offset + done;
+	return done;
+}
+
+void no_such_file()
+{
+	kprint_color(RED_TEXT);
+	kprint("No such file.\n");
+	kprint_color(WHITE_ON_BLACK);
+}
+
+void no_filesystem()
+{
+	kprint_color(RED_TEXT);
+	kprint("The loader didn't say where the filesystem is, it isn't mounted.\n");
+	kprint_color(WHITE_ON_BLACK);
 }
 
-//nodeptr is the buffer NOT a hfolder
-void* create_filesystem(void* nodeptr, void* parent)
+void file_in_use()
 {
-	const uint8_t type = *(uint8_t*)nodeptr;
+	kprint_color(RED_TEXT);
+	kprint("A program is using the file.\n");
+	kprint_color(WHITE_ON_BLACK);
+}
+
+void cat(char path[])
+{
+	fs_index file = fs_open(path);
+	if (file == FS_NONE)
+	{
+		no_such_file();
+		return;
+	}
+	
+	uint32_t size = fs_size(file);
+	for (uint32_t pg = 0; pg * PCACHE_PAGE_SIZE < size; pg++)
+	{
+		pcache_page* page = fs_map(file, pg);
+		if (page == 0x0) break;
+		
+		uint32_t n = size - pg * PCACHE_PAGE_SIZE;
+		if (n > PCACHE_PAGE_SIZE) n = PCACHE_PAGE_SIZE;
+		
+		kprint_n((char*)page->data, n); //printed straight out of the cache
+		pcache_put(page);
+	}
+	kprint("\n");
+}
+
+void write_file(char path[], char text[])
+{
+	fs_index file = fs_open(path);
+	if (file == FS_NONE)
+	{
+		no_such_file();
+		return;
+	}
+	
+	if (vm_maps(file))
+	{
+		file_in_use();
+		return;
+	}
+	
+	uint32_t len = strlen(text);
+	uint32_t done = fs_write(file, fs_size(file), text, len);
+	if (done != len)
+	{
+		kprint_color(RED_TEXT);
+		kprintf("Only %u of %u bytes were written, the disk or the page cache is full.\n", done, len);
+		kprint_color(WHITE_ON_BLACK);
+	}
+}
+
+void compress_file(char path[])
+{
+	fs_index file = fs_open(path);
+	if (file == FS_NONE)
+	{
+		no_such_file();
+		return;
+	}
+	
+	pack_file(node_at(file));
+}
+
+//creates the node for the record at buffer + off, returns FS_NONE for garbage or if the pool is full
+fs_index load_node(void* buffer, uint16_t off, fs_index parent)
+{
+	void* nodeptr = buffer + off;
+	const uint8_t type = *(uint8_t*)nodeptr & FS_TYPE_MASK;
+	const uint8_t packed = type == FS_FILE && (*(uint8_t*)nodeptr & FS_PACKED);
+	if (type != FS_FOLDER && type != FS_FILE) return FS_NONE;
+	if (packed && off + FS_PACKED_HEADER >= FS_TABLE_DATA) return FS_NONE;
+	
+	fs_index idx = alloc_node(type, parent);
+	if (idx == FS_NONE) return FS_NONE;
+	
+	fs_node* node = node_at(idx);
 	switch (type)
 	{
-		case 0:
+		case FS_FOLDER:
 		{
-			const uint8_t children = *(uint8_t*)(nodeptr+1);
-			
-			hfolder* node = kmalloc(sizeof(hfolder));
-			node->type = type;
-			node->parent = parent;
-			node->childCnt = children;
-			node->name = alloc_name(nodeptr + 2);
-			
-			void** childrenAry = kmalloc(sizeof(void*) * children);
+			set_node_name(node, nodeptr + FS_FOLDER_HEADER);
+			break;
+		}
+		case FS_FILE:
+		{
+			node->file.lba = *(uint32_t*)(nodeptr+1);
+			node->file.size = *(uint32_t*)(nodeptr+5); //bytes NOT sectors
 			
-			int slen = strlen(nodeptr + 2) + 1;
-			for (uint16_t i = 0; i < children; i++)
+			uint32_t sectors = fs_cap_pages(node->file.size) * FS_PAGE_SECTORS;
+			if (packed)
 			{
-				uint16_t coffset = *(uint16_t*)(nodeptr+2+slen+i*2);
-				
-				childrenAry[i] = create_filesystem(nodeptr + coffset, node);
+				node->flags |= FS_PACKED;
+				sectors = node->sectors = *(uint32_t*)(nodeptr+9);
 			}
-			node->children = childrenAry;
-			return node;
+			set_node_name(node, nodeptr + (packed ? FS_PACKED_HEADER : FS_FILE_HEADER));
+			
+			uint32_t end = node->file.lba + sectors;
+			if (node->file.lba != 0 && end > fs_next_free) fs_next_free = end;
+			break;
 		}
-		case 1:
+	}
+	return idx;
+}
+
+//builds the heap tree from the disk table, iterative like save_tree
+void load_tree(void* buffer, fs_node* root)
+{
+	fs_frame* stack = kmalloc(sizeof(fs_frame) * FS_MAX_NODES);
+	uint16_t sp = 0;
+	
+	stack[sp++] = (fs_frame){ root, 0, FS_ROOT_HEADER, 0, *(uint8_t*)buffer };
+	while (sp > 0)
+	{
+		fs_frame* f = &stack[sp - 1];
+		if (f->next == f->count)
 		{
-		/* @TODO
-			void* node = kmalloc(17);
-			*(uint8_t*)(node) = type;
-			*(uint32_t*)(node + 1) = (uint32_t)parent;
-			*(uint32_t*)(node + 5) = *(uint32_t*)(nodeptr+1); //file lba
-			*(uint32_t*)(node + 9) = *(uint32_t*)(nodeptr+5); //file size (bytes NOT sectors)
-			*(uint32_t*)(node + 13) = (uint32_t)alloc_name(nodeptr + 9); //file name
-			
-			return node;
-			*/
+			sp--;
+			continue;
+		}
+		
+		uint32_t off = f->start + *(uint16_t*)(buffer + f->offsets + f->next*2);
+		f->next++;
+		if (off <= f->start || off + FS_FILE_HEADER >= FS_TABLE_DATA) continue; //offsets only point forward
+		
+		fs_index idx = load_node(buffer, off, f->node->self);
+		if (idx == FS_NONE) continue;
+		
+		fs_node* child = node_at(idx);
+		add_child(f->node, idx);
+		
+		if (child->type == FS_FOLDER && sp < FS_MAX_NODES)
+		{
+			uint16_t offsets = off + FS_FOLDER_HEADER + strlen(node_name(child)) + 1;
+			uint8_t count = *(uint8_t*)(buffer + off + 1);
+			if (offsets + count*2 > FS_TABLE_DATA) count = 0;
+			stack[sp++] = (fs_frame){ child, off, offsets, 0, count };
 		}
 	}
 	
+	kfree(stack);
 }
 
 void init_filesystem()
 {
-
-	void* buffer = kmalloc(512 * FS_TABLE_SECTORS);
-	
-	lba_read(kernel_end, FS_TABLE_SECTORS, buffer);
-	
-	uint8_t children = *(uint8_t*)buffer;
+	//running programs hold page cache pages and file indices, a remount would pull them away
+	if (vm_maps(FS_NONE))
+	{
+		kprint_color(RED_TEXT);
+		kprint("Programs are running, not remounting.\n");
+		kprint_color(WHITE_ON_BLACK);
+		return;
+	}
 	
-	char* name = kmalloc(5);
-	name[0] = 'r';
-	name[1] = 'o';
-	name[2] = 'o';
-	name[3] = 't';
-	name[4] = '\0';
+	void* buffer = kmalloc(FS_TABLE_SIZE); //zeroed, an empty tree
 	
-	hfolder* root = kmalloc(sizeof(hfolder));
-	root->type = 0x0;
-	root->parent = (void*)0x00; 	
-	root->childCnt = children;
+	//a guessed lba could be anywhere in the kernel, the tree stays in memory only
+	int bad = -1;
+	if (kernel_end == 0) no_filesystem();
+	else
+	{
+		lba_read(kernel_end, FS_TABLE_SECTORS, buffer);
+		bad = check_table(buffer);
+	}
+	if (bad >= 0)
+	{
+		//a torn save_state, better an empty tree than following garbage offsets
+		kprint_color(RED_TEXT);
+		kprintf("Filesystem table checksum mismatch in sector %d, mounting empty.\n", bad);
+		memset(buffer, 0, FS_TABLE_SIZE);
+	}
 	
-	root->name = name; 		 
+	free_nodes();
+	pcache_drop();
+	fs_next_free = kernel_end + FS_TABLE_SECTORS; //the fs table is reserved first
 	
-	void** childrenAry = kmalloc(sizeof(void*) * children);
+	fs_index rootidx = alloc_node(FS_FOLDER, FS_NONE);
+	fs_node* root = node_at(rootidx);
+	set_node_name(root, "root");
 	
-	for (uint16_t i = 0; i < children; i++) //children addresses
-	{
-		uint16_t coffset = *(uint16_t*)(buffer + 1 + i*2);
-		childrenAry[i] = create_filesystem(buffer + coffset, root);
-	}
+	load_tree(buffer, root);
 	
-	root->children = childrenAry;
 	kfree(buffer);
 	
+	dcache_clear();
 	fs_root = root;
 	fs_current = root;
-	
 }
@@ -2,11 +2,33 @@
 #define FILESYSTEM_H
 
 #include <stdint.h>
+#include "pcache.h"
+#include "sched.h"
+
+typedef uint16_t fs_index;
+#define FS_NONE 0xffff
+
+extern uint32_t kernel_end; //lba of the fs table, 0 if the loader didn't say
+
+//nothing in here (or the caches and the ata driver below it) is reentrant, threads hold this around every call
+extern mutex fs_lock;
 
 void create_folder(char name[]);
+void create_file(char name[]);
 
 void ls();
 void cd(char dir[]);
+void cat(char path[]);
+void no_such_file();
+void no_filesystem(); //the loader gave no lba, the tree only lives in memory
+void file_in_use(); //a program maps it (kernel/vm.h)
+void write_file(char path[], char text[]);
+void compress_file(char path[]); //packs the file now and on every later fsflush
+
+fs_index fs_open(char path[]);
+uint32_t fs_size(fs_index file);
+pcache_page* fs_map(fs_index file, uint32_t page);
+uint32_t fs_write(fs_index file, uint32_t offset, void* data, uint32_t len); //bytes written, 0 while a program maps the file or the cache is full
 
 void save_state();
 
@@ -0,0 +1,146 @@
+#include "fsbench.h"
+#include "filesystem.h"
+#include "jfs.h"
+#include "vm.h"
+
+#include "../cpu/timer.h"
+#include "../drivers/ata.h"
+#include "../drivers/screen.h"
+#include "../libc/mem.h"
+#include "../libc/string.h"
+
+/* Filesystem benchmark
+every phase prints one line: "fsbench <phase> n=<n> cycles=<rdtsc delta> ticks=<pit delta>"
+the on-disk table is snapshotted first and restored at the end so runs are repeatable.
+*/
+
+#define FSBENCH_DEFAULT_N 64
+#define FSBENCH_DEFAULT_REPS 8
+
+static uint64_t phase_cycles;
+static uint32_t phase_ticks;
+
+static void phase_begin()
+{
+	phase_ticks = get_tick();
+	phase_cycles = rdtsc();
+}
+
+static void phase_end(char* phase, int n)
+{
+	uint64_t cycles = rdtsc() - phase_cycles;
+	uint32_t ticks = get_tick() - phase_ticks;
+	
+	kprintf("fsbench %s n=%d cycles=%llu ticks=%u\n", phase, n, cycles, ticks);
+}
+
+//"w" + i, i < 1000
+static void bench_name(char* dst, char prefix, int i)
+{
+	dst[0] = prefix;
+	int_to_ascii(i, dst + 1);
+}
+
+//n is the width and depth of the generated trees, reps the repeat count of the cheap phases, 0 picks the default
+void fsbench(int n, int reps)
+{
+	if (n <= 0 || n > FS_MAX_CHILDREN) n = FSBENCH_DEFAULT_N;
+	if (reps <= 0) reps = FSBENCH_DEFAULT_REPS;
+	
+	//it saves and restores the table on disk
+	if (kernel_end == 0)
+	{
+		no_filesystem();
+		return;
+	}
+	
+	//the remount phase can't run under a program
+	if (vm_maps(FS_NONE))
+	{
+		kprint_color(RED_TEXT);
+		kprint("Programs are running, fsbench needs to remount.\n");
+		kprint_color(WHITE_ON_BLACK);
+		return;
+	}
+	
+	//persist whatever the user has, then keep a copy to put back afterwards
+	save_state();
+	void* snapshot = kmalloc(FS_TABLE_SIZE);
+	lba_read(kernel_end, FS_TABLE_SECTORS, snapshot);
+	
+	char path[16] = "/";
+	char name[8] = "";
+	cd(path);
+	
+	create_folder("fsbench");
+	char bench[] = "/fsbench";
+	cd(bench);
+	
+	phase_begin();
+	for (int i = 0; i < n; i++)
+	{
+		bench_name(name, 'w', i);
+		create_folder(name);
+	}
+	phase_end("wide", n);
+	
+	phase_begin();
+	for (int i = 0; i < n; i++)
+	{
+		create_folder("d");
+		char d[] = "d";
+		cd(d);
+	}
+	phase_end("deep", n);
+	
+	//"/fsbench/d/d/d..." all the way down
+	char* deep = kmalloc(10 + n * 2);
+	memcpy(bench, deep, 8);
+	for (int i = 0; i < n; i++)
+	{
+		deep[8 + i*2] = '/';
+		deep[9 + i*2] = 'd';
+	}
+	deep[8 + n*2] = '\0';
+	
+	phase_begin();
+	for (int i = 0; i < n; i++)
+	{
+		bench_name(name, 'w', i);
+		cd(bench);
+		cd(name);
+	}
+	phase_end("cd-wide", n);
+	
+	phase_begin();
+	for (int i = 0; i < reps; i++)
+	{
+		cd(bench);
+		cd(deep);
+	}
+	phase_end("cd-deep", reps);
+	
+	cd(bench);
+	phase_begin();
+	ls();
+	phase_end("ls-wide", n);
+	
+	phase_begin();
+	for (int i = 0; i < reps; i++) save_state();
+	phase_end("flush", reps);
+	
+	phase_begin();
+	for (int i = 0; i < reps; i++) init_filesystem();
+	phase_end("remount", reps);
+	
+	//a deep walk again, now everything comes cold off the disk
+	phase_begin();
+	cd(deep);
+	phase_end("cd-deep-cold", 1);
+	
+	kfree(deep);
+	
+	lba_write(kernel_end, FS_TABLE_SECTORS, snapshot);
+	kfree(snapshot);
+	init_filesystem();
+}
@@ -0,0 +1,6 @@
+#ifndef FSBENCH_H
+#define FSBENCH_H
+
+void fsbench(int n, int reps);
+
+#endif
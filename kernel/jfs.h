@@ -0,0 +1,71 @@
+#ifndef JFS_H
+#define JFS_H
+
+/* JFS on-disk format
+shared between the kernel (filesystem.c) and the host tool (tools/jfsutil.c)
+so this header must not depend on anything but stdint.
+see filesystem.c for the full description of the table layout.
+*/
+
+#include <stdint.h>
+
+#define FS_SECTOR_SIZE 512
+#define FS_TABLE_SECTORS 32
+#define FS_TABLE_SIZE (FS_SECTOR_SIZE * FS_TABLE_SECTORS)
+
+/* checksum trailer, the last bytes of the table:
+uint32_t magic, then one CRC32C per table sector (FS_TABLE_SECTORS of them)
+the crc of the last sector only covers the bytes before the trailer.
+a table without the magic (e.g. a blank disk) is loaded unchecked.
+*/
+#define FS_TABLE_MAGIC 0x4353464a //"JFSC"
+#define FS_TRAILER_SIZE (4 + 4 * FS_TABLE_SECTORS)
+#define FS_TABLE_DATA (FS_TABLE_SIZE - FS_TRAILER_SIZE) //bytes usable by records
+
+//node types (first byte of every node)
+#define FS_FOLDER 0
+#define FS_FILE 1
+#define FS_TYPE_MASK 0x7F
+#define FS_PACKED 0x80 //type flag, the file data is compressed (see below)
+
+//fixed part of every record, names and child offsets follow
+#define FS_ROOT_HEADER 1 //child count
+#define FS_FOLDER_HEADER 2 //type, child count
+#define FS_FILE_HEADER 9 //type, lba (uint32_t), size (uint32_t)
+#define FS_PACKED_HEADER 13 //FS_FILE_HEADER, then the sectors of the extent (uint32_t)
+
+#define FS_MAX_CHILDREN 255 //child count is a byte
+#define FS_MAX_NODES 4096 //nodes the kernel can hold in memory, root included
+
+//file data is allocated in pages
+#define FS_PAGE_SIZE 4096
+#define FS_PAGE_SECTORS (FS_PAGE_SIZE / FS_SECTOR_SIZE)
+
+//pages owned by a file of the given size, rounded up to a power of two so files grow without moving every write
+static inline uint32_t fs_cap_pages(uint32_t size)
+{
+	uint32_t pages = (size + FS_PAGE_SIZE - 1) / FS_PAGE_SIZE;
+	uint32_t cap = pages ? 1 : 0;
+	while (cap < pages) cap <<= 1;
+	return cap;
+}
+
+/* packed files
+the extent starts with a directory: the page count (uint16_t) then the stored length of every page (uint16_t)
+pages follow the directory back to back, each one starting on a sector boundary
+a page is an lz.h block, or stored as is when its length is FS_PAGE_SIZE
+every page is packed whole, including the zeros past the end of the file
+*/
+#define FS_PACK_MAX_PAGES (FS_PAGE_SIZE / 2 - 1) //the directory fits in one page
+
+static inline uint32_t fs_pack_dir_sectors(uint32_t pages)
+{
+	return (2 + pages * 2 + FS_SECTOR_SIZE - 1) / FS_SECTOR_SIZE;
+}
+
+static inline uint32_t fs_pack_sectors(uint32_t len)
+{
+	return (len + FS_SECTOR_SIZE - 1) / FS_SECTOR_SIZE;
+}
+
+#endif
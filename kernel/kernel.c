@@ -1,13 +1,23 @@
+#include "../cpu/fpu.h"
 #include "../cpu/isr.h"
+#include "../cpu/paging.h"
+#include "../cpu/smp.h"
 #include "../drivers/screen.h"
 #include "kernel.h"
+#include "boot.h"
 #include "filesystem.h"
+#include "log.h"
+#include "sched.h"
+#include "shell.h"
+#include "syscall.h"
 #include "../drivers/ata.h"
+#include "../drivers/keyboard.h"
 #include "../libc/string.h"
 #include "../libc/mem.h"
 #include <stdint.h>
 
-void kernel_main() {
+void kernel_main(uint32_t magic, void* info) {
+	init_boot(magic, info);
 	
 	clear_screen();
 	kprint_color(GRAY_TEXT);
@@ -17,8 +27,17 @@ void kernel_main() {
     isr_install();
     kprint_at("Initializing irq...", 0, 3);
     irq_install();
+    init_log();
     kprint_at("Initializing heap...", 0, 4);
     initialize_heap(0x200000);
+    init_scrollback();
+    init_frames(boot.mem_end);
+    if (!init_paging()) klog(LOG_WARN, "no 4MiB pages, programs can't run\n");
+    init_fpu();
+    init_sched("shell");
+    init_klogd();
+    init_smp();
+    init_syscalls();
     kprint_at("Initializing ata... ", 0, 5);
     initialize_ata();
     kprint_color(TEAL_TEXT);
@@ -30,76 +49,18 @@ void kernel_main() {
     kprint("Type END to exit");
     kprint_color(WHITE_ON_BLACK);
     
-    kprint("\n> ");
-}
-
-void parse_shell_command(char* input)
-{
-	char* tmp = input;
-	size_t args = 0;
-	while (*input != '\0')
-	{
-		if (*input == ' ')
-		{
-			*input = '\0';
-			args++;
-		}
-		input++;
-	}
-	input = tmp;
-
-	if (strcmp(input, "END") == 0) {
-    	kprint_color(RED_TEXT);
-        kprint("Stopping the CPU. Bye!\n");
-        asm volatile("hlt");
-    }
-    else if (strcmp(input, "kclear") == 0)
-    {
-    	clear_screen();
-    }
-    else if (strcmp(input, "dumph") == 0)
-    {
-    	#ifdef HEAP_DEBUG
-    	dump_heap();
-    	kprint_color(WHITE_ON_BLACK);
-    	#endif
-    }
-    else if (strcmp(input, "malloc") == 0)
-    {
-    	int ipt = stoi(input+7);
-    	if (ipt <= 0) return;
-    	char adr[16] = "";
-    	hex_to_ascii((uint32_t)kmalloc(ipt), adr);
-    	kprint("Allocated at ");
-    	kprint_color(RED_TEXT);
-    	kprint(adr);
-    	kprint("\n");
-    	kprint_color(WHITE_TEXT);
-    }
-    else if (strcmp(input, "diskr") == 0)
-    {
-    	int lba = stoi(input+6);
-    	
-    	uint8_t sectors = 1;
-    	uint8_t* buf = kmalloc(512 * sectors);
-    	lba_read(lba, sectors, buf);
-    	kfree(buf);
-    }
-    else if (strcmp(input, "ls") == 0)
-    {
-    	ls();
-    }
-    else if (strcmp(input, "fsflush") == 0)
-    {
-    	save_state();
-    }
-    else if (strcmp(input, "folder") == 0)
-    {
-    	create_folder(input+7);
-    }
-    else if (strcmp(input, "cd") == 0)
+    kprint("\n");
+    
+    //unattended runs (make bench) put their commands here
+    run_script(SHELL_AUTORUN);
+    kprint("> ");
+    
+    //this is the shell thread now, interrupt handlers only queue keys for it
+    //klogd prints the log and the idle thread halts the cpu while everyone waits
+    for (;;)
     {
-    	cd(input+3);
+    	keyboard_process();
+    	keyboard_wait();
     }
 }
 
@@ -0,0 +1,23 @@
+#include "ksyms.h"
+
+//overridden by ksyms.gen.c on the second link
+__attribute__((weak)) const ksym ksyms[1] = { { 0, 0x0 } };
+__attribute__((weak)) const uint32_t ksym_count = 0;
+
+extern char etext[]; //end of the code, from the linker
+
+const ksym* ksym_find(uint32_t addr)
+{
+	if (ksym_count == 0 || addr < ksyms[0].addr || addr >= (uint32_t)etext) return 0x0;
+
+	//last symbol at or below addr
+	uint32_t low = 0;
+	uint32_t high = ksym_count;
+	while (high - low > 1)
+	{
+		uint32_t mid = (low + high) / 2;
+		if (ksyms[mid].addr <= addr) low = mid;
+		else high = mid;
+	}
+	return &ksyms[low];
+}
@@ -0,0 +1,23 @@
+#ifndef KSYMS_H
+#define KSYMS_H
+
+#include <stdint.h>
+
+/* Kernel symbols
+the binary image has no symbols, so the Makefile links the kernel twice: the first link gets the
+empty table below, nm lists its functions into ksyms.gen.c and the second link adds that file.
+it only adds data after the code, the addresses it lists are the ones of the final kernel.
+*/
+
+typedef struct {
+	uint32_t addr;
+	char* name;
+} ksym;
+
+extern const ksym ksyms[]; //sorted by addr
+extern const uint32_t ksym_count;
+
+//the function addr is in, 0x0 if it is outside the kernel text
+const ksym* ksym_find(uint32_t addr);
+
+#endif
@@ -0,0 +1,213 @@
+#include "log.h"
+
+#include "../cpu/apic.h"
+#include "../cpu/isr.h"
+#include "../cpu/smp.h"
+#include "../cpu/timer.h"
+#include "sched.h"
+#include "../drivers/screen.h"
+#include "../drivers/serial.h"
+#include "../libc/printf.h"
+
+#define LOG_MASK (LOG_RING_SIZE - 1)
+#define LOG_CONTEXTS (1 + APIC_MAX_CPUS) //the threads, then every cpu's irq ring
+
+//32 bytes
+typedef struct {
+	uint32_t seq; //global order across the rings
+	uint32_t tick;
+	char* fmt;
+	uint32_t level;
+	uint32_t args[LOG_ARGS];
+} log_record;
+
+typedef struct {
+	log_record records[LOG_RING_SIZE];
+	volatile uint32_t head; //written by the producer only
+	volatile uint32_t tail; //written by log_drain only
+	volatile uint32_t dropped; //written by the producer only
+	uint32_t reported; //dropped records log_drain already told about
+} log_ring;
+
+static log_ring rings[LOG_CONTEXTS];
+static uint32_t log_seq = 0;
+
+static int console_level = LOG_INFO;
+static int serial_level = LOG_INFO;
+
+static int current_level = LOG_INFO; //level of whatever is being printed right now
+
+static volatile uint8_t draining = 0;
+
+static void serial_mirror(char* text, int len)
+{
+	if (current_level <= serial_level) serial_write(text, len);
+}
+
+void init_log()
+{
+	kprint_set_mirror(serial_mirror);
+}
+
+static void klogd(void* arg)
+{
+	for (;;)
+	{
+		log_drain();
+		thread_sleep(MS_TO_TICKS(LOG_DRAIN_MS));
+	}
+}
+
+void init_klogd()
+{
+	thread_create("klogd", PRIORITY_HIGH, klogd, 0x0);
+}
+
+void set_log_level(int console, int serial)
+{
+	console_level = console;
+	serial_level = serial;
+}
+
+void klog_record(int level, char* fmt, ...)
+{
+	//with interrupts disabled nothing else on this cpu can get at the ring, and no other cpu uses it
+	uint32_t eflags = irq_save();
+	uint8_t cpu = smp_cpu();
+	log_ring* ring = &rings[(eflags & 0x200) && cpu == 0 ? 0 : 1 + cpu];
+	
+	uint32_t head = ring->head;
+	if (head - ring->tail >= LOG_RING_SIZE)
+	{
+		ring->dropped++;
+		irq_restore(eflags);
+		return;
+	}
+	
+	log_record* r = &ring->records[head & LOG_MASK];
+	r->seq = __atomic_fetch_add(&log_seq, 1, __ATOMIC_RELAXED);
+	r->tick = get_tick();
+	r->fmt = fmt;
+	r->level = level;
+	
+	va_list args;
+	va_start(args, fmt);
+	for (int i = 0; i < LOG_ARGS; i++) r->args[i] = va_arg(args, uint32_t);
+	va_end(args);
+	
+	//the record is complete before it is published, log_drain may run on another cpu
+	__atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+	irq_restore(eflags);
+}
+
+//time since boot from the tick, "[  12.345] "
+static int log_prefix(char* buf, uint32_t size, log_record* r)
+{
+	return ksnprintf(buf, size, "[%4u.%03u] ", r->tick / TIMER_HZ, (r->tick % TIMER_HZ) * 1000 / TIMER_HZ);
+}
+
+//formats a record and sends it to the console and/or serial depending on the levels
+static void log_emit(log_record* r, int force)
+{
+	char buf[KPRINTF_MAX];
+	int len = log_prefix(buf, KPRINTF_MAX, r);
+	len += kwsnprintf(buf + len, KPRINTF_MAX - len, r->fmt, r->args, LOG_ARGS);
+	if (len >= KPRINTF_MAX) len = KPRINTF_MAX - 1;
+	
+	int level = r->level;
+	if (!force && level > console_level)
+	{
+		if (level <= serial_level) serial_write(buf, len);
+		return;
+	}
+	
+	unsigned char colors[] = { RED_TEXT, YELLOW_TEXT, WHITE_ON_BLACK, GRAY_TEXT };
+	kprint_color(colors[level > LOG_DEBUG ? LOG_DEBUG : level]);
+	current_level = level;
+	kprint_n(buf, len); //the mirror passes it on to serial
+	current_level = LOG_INFO;
+	kprint_color(WHITE_ON_BLACK);
+}
+
+//index of the ring whose next record (between pos and end) has the lowest sequence number, -1 if all are done
+static int log_next(uint32_t pos[], uint32_t end[])
+{
+	int best = -1;
+	for (int i = 0; i < LOG_CONTEXTS; i++)
+	{
+		if (pos[i] == end[i]) continue;
+		if (best < 0 || (int32_t)(rings[i].records[pos[i] & LOG_MASK].seq - rings[best].records[pos[best] & LOG_MASK].seq) < 0)
+			best = i;
+	}
+	return best;
+}
+
+void log_drain()
+{
+	//one drain at a time, a fault can interrupt klogd
+	uint32_t flags = irq_save();
+	uint8_t busy = draining;
+	draining = 1;
+	irq_restore(flags);
+	if (busy) return;
+	
+	uint32_t pos[LOG_CONTEXTS];
+	uint32_t end[LOG_CONTEXTS];
+	for (int i = 0; i < LOG_CONTEXTS; i++)
+	{
+		pos[i] = rings[i].tail;
+		end[i] = __atomic_load_n(&rings[i].head, __ATOMIC_ACQUIRE);
+	}
+	
+	int i;
+	while ((i = log_next(pos, end)) >= 0)
+	{
+		log_emit(&rings[i].records[pos[i] & LOG_MASK], 0);
+		pos[i]++;
+		__atomic_store_n(&rings[i].tail, pos[i], __ATOMIC_RELEASE); //frees the slot for the producer
+	}
+	
+	for (i = 0; i < LOG_CONTEXTS; i++)
+	{
+		uint32_t dropped = rings[i].dropped - rings[i].reported;
+		if (dropped == 0) continue;
+		rings[i].reported += dropped;
+		kprint_color(YELLOW_TEXT);
+		kprintf("log: %u records dropped\n", dropped);
+		kprint_color(WHITE_ON_BLACK);
+	}
+	draining = 0;
+}
+
+int log_pending()
+{
+	for (int i = 0; i < LOG_CONTEXTS; i++)
+	{
+		if (rings[i].tail != rings[i].head) return 1;
+	}
+	return 0;
+}
+
+void dmesg()
+{
+	log_drain(); //everything left is printed and can be overwritten, but only by newer records
+	
+	uint32_t pos[LOG_CONTEXTS];
+	uint32_t end[LOG_CONTEXTS];
+	for (int i = 0; i < LOG_CONTEXTS; i++)
+	{
+		end[i] = __atomic_load_n(&rings[i].head, __ATOMIC_ACQUIRE);
+		pos[i] = end[i] > LOG_RING_SIZE ? end[i] - LOG_RING_SIZE : 0;
+	}
+	
+	int i;
+	while ((i = log_next(pos, end)) >= 0)
+	{
+		//an interrupt may be overwriting the slot, print a copy unless the producer got to it
+		log_record r = rings[i].records[pos[i] & LOG_MASK];
+		asm volatile("" : : : "memory");
+		uint32_t overwritten = rings[i].head - pos[i] >= LOG_RING_SIZE;
+		pos[i]++;
+		if (!overwritten) log_emit(&r, 1);
+	}
+}
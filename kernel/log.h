@@ -0,0 +1,44 @@
+#ifndef LOG_H
+#define LOG_H
+
+#include <stdint.h>
+
+/* Kernel log (dmesg)
+klog only stores a record: the tick, the level, the format string and up to LOG_ARGS words of arguments.
+formatting and output happen later in log_drain, which the klogd thread runs every LOG_DRAIN_MS,
+so logging costs a few stores, never touches a device and never wakes or switches threads.
+the shell drains before its prompt and exceptions drain at once, so those don't wait for klogd.
+%s arguments are kept as pointers, they must still be valid when the record is printed (use literals).
+
+every ring has a single producer, so writers take no lock: threads (they only run on the boot cpu)
+write the thread ring with interrupts disabled for the store, everything else writes the irq ring of its cpu.
+rings never block, a full ring drops the record and counts it.
+
+drained records at or below the console level are printed (and colored by level),
+records at or below the serial level go out on COM1.
+plain kprint output counts as LOG_INFO, so it is mirrored to serial while the serial level allows info.
+*/
+
+#define LOG_ERR 0
+#define LOG_WARN 1
+#define LOG_INFO 2
+#define LOG_DEBUG 3
+
+#define LOG_ARGS 4
+#define LOG_RING_SIZE 128 //records per ring, must be a power of two
+#define LOG_DRAIN_MS 50 //klogd's period
+
+void init_log();
+void init_klogd(); //starts the thread that drains the log, needs the scheduler
+void set_log_level(int console, int serial);
+
+//reads LOG_ARGS 32 bit words after fmt (a 64 bit argument takes two)
+void klog_record(int level, char* fmt, ...);
+//arguments are padded with zeros so there are always LOG_ARGS words to read
+#define klog(level, ...) klog_record(level, __VA_ARGS__, 0, 0, 0, 0)
+
+void log_drain(); //prints the records that weren't printed yet
+int log_pending();
+void dmesg(); //prints every record still in the rings
+
+#endif
@@ -0,0 +1,209 @@
+#include "pcache.h"
+
+#include "../libc/mem.h"
+#include "../cpu/paging.h"
+#include "../drivers/ata.h"
+
+static pcache_page pages[PCACHE_PAGES];
+static pcache_page* buckets[PCACHE_BUCKETS];
+
+//lru list, head is most recently used
+static pcache_page* lru_head = 0x0;
+static pcache_page* lru_tail = 0x0;
+static uint16_t pages_used = 0;
+
+static inline uint32_t pcache_bucket(uint16_t file, uint32_t index)
+{
+	return (file * 31 + index) % PCACHE_BUCKETS;
+}
+
+static void lru_unlink(pcache_page* p)
+{
+	if (p->lprev != 0x0) p->lprev->lnext = p->lnext;
+	else lru_head = p->lnext;
+
+	if (p->lnext != 0x0) p->lnext->lprev = p->lprev;
+	else lru_tail = p->lprev;
+
+	p->lprev = 0x0;
+	p->lnext = 0x0;
+}
+
+static void lru_push(pcache_page* p)
+{
+	p->lprev = 0x0;
+	p->lnext = lru_head;
+	if (lru_head != 0x0) lru_head->lprev = p;
+	lru_head = p;
+	if (lru_tail == 0x0) lru_tail = p;
+}
+
+static void hash_unlink(pcache_page* p)
+{
+	pcache_page** link = &buckets[pcache_bucket(p->file, p->index)];
+	while (*link != 0x0)
+	{
+		if (*link == p)
+		{
+			*link = p->hnext;
+			break;
+		}
+		link = &(*link)->hnext;
+	}
+	p->hnext = 0x0;
+}
+
+static void page_writeback(pcache_page* p)
+{
+	if (!(p->flags & PAGE_DIRTY) || p->lba == 0) return;
+
+	lba_write(p->lba, PCACHE_PAGE_SECTORS, p->data);
+	p->flags &= ~PAGE_DIRTY;
+}
+
+//finds a free slot or evicts the least recently used unreferenced page
+static pcache_page* pcache_victim()
+{
+	if (pages_used < PCACHE_PAGES)
+	{
+		pcache_page* p = &pages[pages_used++];
+		//a frame can be mapped into programs (kernel/vm.h)
+		if (p->data == 0x0) p->data = (uint8_t*)frame_alloc();
+		if (p->data == 0x0) p->data = kmalloc(PCACHE_PAGE_SIZE);
+		return p;
+	}
+
+	//dirty pages without a sector of their own (packed files) can only be written by their file
+	pcache_page* p = lru_tail;
+	while (p != 0x0 && (p->refs != 0 || ((p->flags & PAGE_DIRTY) && p->lba == 0))) p = p->lprev;
+	if (p == 0x0) return 0x0;
+
+	page_writeback(p);
+	lru_unlink(p);
+	hash_unlink(p);
+	return p;
+}
+
+pcache_page* pcache_find(uint16_t file, uint32_t index)
+{
+	pcache_page* p = buckets[pcache_bucket(file, index)];
+	while (p != 0x0)
+	{
+		if (p->file == file && p->index == index)
+		{
+			if (p != lru_head)
+			{
+				lru_unlink(p);
+				lru_push(p);
+			}
+			p->refs++;
+			return p;
+		}
+		p = p->hnext;
+	}
+	return 0x0;
+}
+
+pcache_page* pcache_get(uint16_t file, uint32_t index, uint32_t lba)
+{
+	pcache_page* p = pcache_find(file, index);
+	if (p != 0x0) return p;
+
+	p = pcache_victim();
+	if (p == 0x0) return 0x0;
+
+	p->file = file;
+	p->index = index;
+	p->lba = lba;
+	p->flags = 0;
+	p->refs = 1;
+
+	if (lba != 0) lba_read(lba, PCACHE_PAGE_SECTORS, p->data);
+	else memset(p->data, 0, PCACHE_PAGE_SIZE);
+
+	uint32_t b = pcache_bucket(file, index);
+	p->hnext = buckets[b];
+	buckets[b] = p;
+	lru_push(p);
+	return p;
+}
+
+void pcache_put(pcache_page* page)
+{
+	if (page != 0x0 && page->refs > 0) page->refs--;
+}
+
+void pcache_dirty(pcache_page* page)
+{
+	page->flags |= PAGE_DIRTY;
+}
+
+void pcache_rebase(uint16_t file, uint32_t lba)
+{
+	for (pcache_page* p = lru_head; p != 0x0; p = p->lnext)
+	{
+		if (p->file == file) p->lba = lba + p->index * PCACHE_PAGE_SECTORS;
+	}
+}
+
+void pcache_detach(uint16_t file)
+{
+	for (pcache_page* p = lru_head; p != 0x0; p = p->lnext)
+	{
+		if (p->file != file) continue;
+		p->flags &= ~PAGE_DIRTY;
+		p->lba = 0;
+	}
+}
+
+int pcache_file_dirty(uint16_t file)
+{
+	for (pcache_page* p = lru_head; p != 0x0; p = p->lnext)
+	{
+		if (p->file == file && (p->flags & PAGE_DIRTY)) return 1;
+	}
+	return 0;
+}
+
+uint16_t pcache_room()
+{
+	uint16_t room = PCACHE_PAGES - pages_used;
+	for (pcache_page* p = lru_head; p != 0x0; p = p->lnext)
+	{
+		if (p->refs == 0 && !((p->flags & PAGE_DIRTY) && p->lba == 0)) room++;
+	}
+	return room;
+}
+
+void pcache_writeback_file(uint16_t file)
+{
+	for (pcache_page* p = lru_head; p != 0x0; p = p->lnext)
+	{
+		if (p->file == file) page_writeback(p);
+	}
+}
+
+void pcache_writeback()
+{
+	for (pcache_page* p = lru_head; p != 0x0; p = p->lnext)
+	{
+		page_writeback(p);
+	}
+}
+
+void pcache_drop()
+{
+	for (uint16_t i = 0; i < PCACHE_PAGES; i++)
+	{
+		pages[i].flags = 0;
+		pages[i].refs = 0;
+		pages[i].hnext = 0x0;
+		pages[i].lprev = 0x0;
+		pages[i].lnext = 0x0;
+	}
+	for (uint16_t i = 0; i < PCACHE_BUCKETS; i++) buckets[i] = 0x0;
+
+	lru_head = 0x0;
+	lru_tail = 0x0;
+	pages_used = 0;
+}
@@ -0,0 +1,57 @@
+#ifndef PCACHE_H
+#define PCACHE_H
+
+#include <stdint.h>
+#include "jfs.h"
+
+/* Page cache for file contents
+pages are keyed by (file, page index) and hold PCACHE_PAGE_SIZE bytes.
+pcache_get hands out a borrowed, reference counted page, read it in place and pcache_put it back.
+writers modify the page in place and mark it dirty, pcache_writeback flushes dirty pages to disk.
+only unreferenced pages are evicted (least recently used first).
+dirty pages without an lba (packed files) stay until their file is packed again.
+*/
+
+#define PCACHE_PAGE_SIZE FS_PAGE_SIZE
+#define PCACHE_PAGE_SECTORS FS_PAGE_SECTORS
+#define PCACHE_PAGES 64
+#define PCACHE_BUCKETS 32
+
+#define PAGE_DIRTY 0x01
+
+typedef struct pcache_page {
+	uint16_t file;
+	uint16_t flags;
+	uint32_t index;
+	uint32_t lba; //first sector of the page on disk, 0 if it has no backing yet
+	uint32_t refs;
+	uint8_t* data;
+	struct pcache_page* hnext;
+	struct pcache_page* lprev;
+	struct pcache_page* lnext;
+} pcache_page;
+
+//returns 0x0 if every page is referenced
+//lba 0 hands out a zeroed page, the caller fills it
+pcache_page* pcache_get(uint16_t file, uint32_t index, uint32_t lba);
+//like pcache_get but never reads, 0x0 if the page isn't cached
+pcache_page* pcache_find(uint16_t file, uint32_t index);
+void pcache_put(pcache_page* page);
+void pcache_dirty(pcache_page* page);
+
+//the file moved on disk, page i is now at lba + i * PCACHE_PAGE_SECTORS
+void pcache_rebase(uint16_t file, uint32_t lba);
+
+//the file was rewritten somewhere else (packed files), its pages are clean and have no sectors anymore
+void pcache_detach(uint16_t file);
+int pcache_file_dirty(uint16_t file);
+//pages pcache_get can still take over, dirty pages without an lba don't count
+uint16_t pcache_room();
+
+void pcache_writeback_file(uint16_t file);
+void pcache_writeback();
+
+//forgets every page without writing it back (remount)
+void pcache_drop();
+
+#endif
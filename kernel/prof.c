@@ -0,0 +1,110 @@
+#include "prof.h"
+#include "ksyms.h"
+
+#include "../drivers/screen.h"
+#include "../libc/mem.h"
+
+extern char etext[];
+
+static uint32_t* hist = 0x0;
+static uint32_t buckets = 0;
+static uint32_t every = 1;
+static uint32_t countdown = 1;
+static uint32_t samples = 0;
+static uint32_t other = 0; //outside the kernel text
+static volatile uint8_t running = 0;
+
+#define PROF_BASE 0x10000
+
+int prof_start(uint32_t n)
+{
+	running = 0; //the interrupt stops using hist
+	kfree(hist);
+	buckets = (((uint32_t)etext - PROF_BASE) >> PROF_BUCKET_SHIFT) + 1;
+	hist = kmalloc(buckets * sizeof(uint32_t)); //zeroed
+	if (hist == 0x0) return 0;
+
+	every = n == 0 ? 1 : n;
+	countdown = every;
+	samples = 0;
+	other = 0;
+	running = 1;
+	return 1;
+}
+
+void prof_stop()
+{
+	running = 0;
+}
+
+void prof_sample(registers_t* r)
+{
+	if (!running || --countdown != 0) return;
+	countdown = every;
+
+	uint32_t i = (r->eip - PROF_BASE) >> PROF_BUCKET_SHIFT;
+	if (r->eip >= PROF_BASE && i < buckets) hist[i]++;
+	else other++;
+	samples++;
+}
+
+typedef struct {
+	const ksym* sym;
+	uint32_t count;
+} prof_entry;
+
+//keeps the list sorted, the smallest falls off the end
+static void top_insert(prof_entry top[], const ksym* sym, uint32_t count)
+{
+	if (count == 0 || count <= top[PROF_TOP - 1].count) return;
+
+	int i = PROF_TOP - 1;
+	for (; i > 0 && top[i - 1].count < count; i--) top[i] = top[i - 1];
+	top[i].sym = sym;
+	top[i].count = count;
+}
+
+void prof_report()
+{
+	if (hist == 0x0)
+	{
+		kprint_color(RED_TEXT);
+		kprint("No profile, run prof start first.\n");
+		kprint_color(WHITE_ON_BLACK);
+		return;
+	}
+
+	//buckets are in address order, so the ones of a function follow each other
+	prof_entry top[PROF_TOP] = { 0 };
+	const ksym* sym = 0x0;
+	uint32_t count = 0;
+	uint32_t unknown = 0;
+	for (uint32_t i = 0; i < buckets; i++)
+	{
+		if (hist[i] == 0) continue;
+
+		const ksym* s = ksym_find(PROF_BASE + (i << PROF_BUCKET_SHIFT));
+		if (s == 0x0)
+		{
+			unknown += hist[i];
+			continue;
+		}
+		if (s != sym)
+		{
+			top_insert(top, sym, count);
+			sym = s;
+			count = 0;
+		}
+		count += hist[i];
+	}
+	top_insert(top, sym, count);
+
+	kprintf("prof samples=%u every=%u other=%u%s\n", samples, every, other + unknown, running ? " (running)" : "");
+	if (samples == 0) return;
+
+	for (uint8_t i = 0; i < PROF_TOP && top[i].count != 0; i++)
+	{
+		uint32_t permille = top[i].count * 1000 / samples;
+		kprintf("%8u %3u.%u%% %s\n", top[i].count, permille / 10, permille % 10, top[i].sym->name);
+	}
+}
@@ -0,0 +1,24 @@
+#ifndef PROF_H
+#define PROF_H
+
+#include <stdint.h>
+#include "../cpu/isr.h"
+
+/* Sampling profiler
+while it runs, every n'th timer interrupt records where the interrupted code was in a histogram
+of the kernel text, one counter per PROF_BUCKET bytes. the report adds the counters up per function
+(ksyms.h) and lists the busiest. the idle thread skips ticks (cpu/timer.h), so idle time is
+mostly not sampled.
+*/
+
+#define PROF_BUCKET_SHIFT 4
+#define PROF_BUCKET (1 << PROF_BUCKET_SHIFT)
+#define PROF_TOP 12
+
+int prof_start(uint32_t every); //clears the last run, 0 if the histogram can't be allocated
+void prof_stop();
+void prof_report();
+
+void prof_sample(registers_t* r); //called by the timer interrupt
+
+#endif
@@ -0,0 +1,302 @@
+#include "sched.h"
+#include "vm.h"
+
+#include "../cpu/gdt.h"
+#include "../cpu/idt.h"
+#include "../cpu/paging.h"
+#include "../cpu/timer.h"
+#include "../drivers/screen.h"
+#include "../libc/mem.h"
+
+static thread threads[THREAD_MAX];
+static wait_queue run_queue[THREAD_PRIORITIES];
+
+static thread* current = 0x0;
+static thread* idle = 0x0;
+static volatile uint8_t need_resched = 0;
+static uint32_t slice = SCHED_SLICE;
+
+static void queue_push(wait_queue* q, thread* t)
+{
+	t->next = 0x0;
+	if (q->tail != 0x0) q->tail->next = t;
+	else q->head = t;
+	q->tail = t;
+}
+
+static thread* queue_pop(wait_queue* q)
+{
+	thread* t = q->head;
+	if (t == 0x0) return 0x0;
+
+	q->head = t->next;
+	if (q->head == 0x0) q->tail = 0x0;
+	t->next = 0x0;
+	return t;
+}
+
+//asks for a switch if t beats the running thread
+static void make_ready(thread* t)
+{
+	t->state = THREAD_READY;
+	queue_push(&run_queue[t->priority], t);
+	if (current == idle || t->priority < current->priority) need_resched = 1;
+}
+
+static thread* pick_next()
+{
+	for (uint8_t p = 0; p < THREAD_PRIORITIES; p++)
+	{
+		thread* t = queue_pop(&run_queue[p]);
+		if (t != 0x0) return t;
+	}
+	return idle;
+}
+
+//a dead thread runs on its stack until it is switched away from, so it is freed on a later switch
+static void reap()
+{
+	for (uint8_t i = 0; i < THREAD_MAX; i++)
+	{
+		if (threads[i].state != THREAD_DEAD || &threads[i] == current) continue;
+		kfree(threads[i].stack);
+		threads[i].stack = 0x0;
+		threads[i].state = THREAD_FREE;
+	}
+}
+
+registers_t* schedule(registers_t* r)
+{
+	if (!need_resched || current == 0x0) return r;
+
+	current->regs = r;
+	if (current == idle) idle->state = THREAD_READY;
+	else if (current->state == THREAD_RUNNING) make_ready(current);
+
+	thread* next = pick_next();
+	reap();
+
+	next->state = THREAD_RUNNING;
+	fpu_switch(next);
+	paging_switch(next->cr3);
+	//ring 3 enters the kernel on the thread's stack, threads only run on the boot cpu
+	if (next->stack != 0x0) tss_set_stack(0, (uint32_t)(next->stack + THREAD_STACK_SIZE));
+	current = next;
+	slice = SCHED_SLICE;
+	need_resched = 0;
+	return next->regs;
+}
+
+void sched_tick()
+{
+	if (current == 0x0) return;
+
+	if (--slice == 0)
+	{
+		slice = SCHED_SLICE;
+		need_resched = 1;
+	}
+}
+
+static void thread_start()
+{
+	current->entry(current->arg);
+	thread_exit();
+}
+
+static void idle_loop(void* arg)
+{
+	for (;;) timer_idle();
+}
+
+//claims a slot and builds the frame the first switch to the thread pops, the thread isn't queued yet
+static thread* thread_setup(char name[], uint8_t priority, void (*entry)(void*), void* arg)
+{
+	uint32_t flags = irq_save();
+	thread* t = 0x0;
+	for (uint8_t i = 0; i < THREAD_MAX && t == 0x0; i++)
+	{
+		if (threads[i].state == THREAD_FREE) t = &threads[i];
+	}
+	if (t != 0x0) t->state = THREAD_BLOCKED;
+	irq_restore(flags);
+	if (t == 0x0) return 0x0;
+
+	t->stack = kmalloc(THREAD_STACK_SIZE);
+	if (t->stack == 0x0)
+	{
+		t->state = THREAD_FREE;
+		return 0x0;
+	}
+
+	//iret doesn't pop esp and ss when it stays in ring 0, the last 8 bytes are never used
+	registers_t* r = (registers_t*)(t->stack + THREAD_STACK_SIZE - sizeof(registers_t));
+	r->ds = 0x10;
+	r->cs = KERNEL_CS;
+	r->eip = (uint32_t)thread_start;
+	r->eflags = 0x202; //interrupts on
+
+	t->regs = r;
+	t->priority = priority;
+	t->entry = entry;
+	t->arg = arg;
+	t->next = 0x0;
+	t->fpu_used = 0;
+	t->vm = 0x0;
+	t->cr3 = 0;
+
+	uint8_t i = 0;
+	for (; i < THREAD_NAME_LEN - 1 && name[i] != '\0'; i++) t->name[i] = name[i];
+	t->name[i] = '\0';
+	return t;
+}
+
+void init_sched(char name[])
+{
+	for (uint8_t i = 0; i < THREAD_MAX; i++) threads[i].id = i;
+
+	thread* boot = &threads[0];
+	boot->state = THREAD_RUNNING;
+	boot->priority = PRIORITY_NORMAL;
+	uint8_t i = 0;
+	for (; i < THREAD_NAME_LEN - 1 && name[i] != '\0'; i++) boot->name[i] = name[i];
+	boot->name[i] = '\0';
+
+	idle = thread_setup("idle", THREAD_PRIORITIES, idle_loop, 0x0);
+	idle->state = THREAD_READY;
+	current = boot;
+}
+
+thread* thread_create(char name[], uint8_t priority, void (*entry)(void*), void* arg)
+{
+	if (priority >= THREAD_PRIORITIES) priority = THREAD_PRIORITIES - 1;
+
+	thread* t = thread_setup(name, priority, entry, arg);
+	if (t == 0x0) return 0x0;
+
+	uint32_t flags = irq_save();
+	make_ready(t);
+	irq_restore(flags);
+	if (flags & 0x200) thread_preempt();
+	return t;
+}
+
+//iret to ring 3 pops esp and ss as well
+static void user_start(thread* t, uint32_t eip, uint32_t esp)
+{
+	registers_t* r = t->regs;
+	r->ds = USER_DS;
+	r->cs = USER_CS;
+	r->eip = eip;
+	r->esp = esp;
+	r->ss = USER_DS;
+
+	uint32_t flags = irq_save();
+	make_ready(t);
+	irq_restore(flags);
+	if (flags & 0x200) thread_preempt();
+}
+
+thread* thread_create_process(char name[], uint8_t priority, uint32_t eip, uint32_t esp, struct vm_space* vm)
+{
+	if (priority >= THREAD_PRIORITIES) priority = THREAD_PRIORITIES - 1;
+
+	thread* t = thread_setup(name, priority, 0x0, 0x0);
+	if (t == 0x0) return 0x0;
+
+	t->vm = vm;
+	t->cr3 = vm->pd;
+	user_start(t, eip, esp);
+	return t;
+}
+
+thread* thread_current()
+{
+	return current;
+}
+
+void thread_yield()
+{
+	need_resched = 1;
+	asm volatile("int %0" : : "i" (IRQ_YIELD) : "memory");
+}
+
+void thread_preempt()
+{
+	if (need_resched) thread_yield();
+}
+
+void thread_exit()
+{
+	if (current->vm != 0x0)
+	{
+		vm_destroy(current->vm);
+		current->vm = 0x0;
+	}
+	irq_save();
+	current->state = THREAD_DEAD;
+	fpu_forget(current);
+	thread_yield();
+	for (;;); //never switched back to
+}
+
+static void sleep_done(void* arg)
+{
+	make_ready(arg);
+}
+
+void thread_sleep(uint32_t ticks)
+{
+	uint32_t flags = irq_save();
+	current->state = THREAD_SLEEPING;
+	timer_add(&current->timer, ticks, sleep_done, current);
+	thread_yield();
+	irq_restore(flags);
+}
+
+void thread_wait(wait_queue* q)
+{
+	current->state = THREAD_BLOCKED;
+	queue_push(q, current);
+	thread_yield();
+}
+
+void thread_wakeup(wait_queue* q)
+{
+	uint32_t flags = irq_save();
+	thread* t;
+	while ((t = queue_pop(q)) != 0x0) make_ready(t);
+	irq_restore(flags);
+}
+
+void mutex_lock(mutex* m)
+{
+	uint32_t flags = irq_save();
+	while (m->owner != 0x0 && m->owner != current) thread_wait(&m->waiters);
+	m->owner = current;
+	m->depth++;
+	irq_restore(flags);
+}
+
+void mutex_unlock(mutex* m)
+{
+	uint32_t flags = irq_save();
+	if (--m->depth == 0)
+	{
+		m->owner = 0x0;
+		thread_wakeup(&m->waiters);
+	}
+	irq_restore(flags);
+	if (flags & 0x200) thread_preempt();
+}
+
+void list_threads()
+{
+	char* states[] = { "free", "ready", "running", "blocked", "sleeping", "dead" };
+	for (uint8_t i = 0; i < THREAD_MAX; i++)
+	{
+		thread* t = &threads[i];
+		if (t->state == THREAD_FREE) continue;
+		kprintf("%2u %-11s %-8s %u\n", t->id, t->name, states[t->state], t->priority);
+	}
+}
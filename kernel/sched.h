@@ -0,0 +1,96 @@
+#ifndef SCHED_H
+#define SCHED_H
+
+#include <stdint.h>
+#include "../cpu/fpu.h"
+#include "../cpu/isr.h"
+#include "../cpu/timer.h"
+#include "timers.h"
+
+/* Kernel threads
+every thread has its own stack, a switch happens on the way out of an interrupt:
+irq_handler returns the registers to resume and interrupt.asm loads esp from them,
+so a thread that isn't running is just the registers_t frame on top of its stack.
+threads give up the cpu with int IRQ_YIELD, which goes through the same path.
+
+the highest priority ready thread runs (0 is the highest), threads of the same priority
+take turns every SCHED_SLICE ticks. when nothing is ready the idle thread halts the cpu.
+
+thread_wait and thread_wakeup are the sleep/wakeup primitives, a waiter checks its condition
+with interrupts disabled (irq_save) and calls thread_wait without enabling them, so a wakeup
+from an interrupt handler can't slip in between. thread_wakeup can be called from anywhere.
+*/
+
+#define THREAD_MAX 16
+#define THREAD_STACK_SIZE 0x4000
+#define THREAD_NAME_LEN 12
+
+#define THREAD_PRIORITIES 3
+#define PRIORITY_HIGH 0 //klogd
+#define PRIORITY_NORMAL 1 //the shell
+#define PRIORITY_LOW 2 //background jobs
+
+#define SCHED_SLICE MS_TO_TICKS(20)
+
+#define THREAD_FREE 0
+#define THREAD_READY 1
+#define THREAD_RUNNING 2
+#define THREAD_BLOCKED 3
+#define THREAD_SLEEPING 4
+#define THREAD_DEAD 5
+
+typedef struct thread {
+	registers_t* regs; //saved context while the thread isn't running
+	uint8_t state;
+	uint8_t priority;
+	uint8_t id;
+	ktimer timer; //wakes a sleeping thread
+	void (*entry)(void*);
+	void* arg;
+	uint8_t* stack; //0x0 for the boot thread
+	struct vm_space* vm; //programs only, kernel/vm.h
+	uint32_t cr3; //page directory, 0 for the kernel's
+	struct thread* next; //run queue or wait queue
+	char name[THREAD_NAME_LEN];
+	uint8_t fpu_used; //fpu holds its registers
+	uint8_t fpu[FPU_STATE_SIZE] __attribute__((aligned(16))); //saved while another thread has the fpu
+} thread;
+
+typedef struct {
+	thread* head;
+	thread* tail;
+} wait_queue;
+
+//sleeping lock, the owner may lock it again (it has to unlock as many times)
+typedef struct {
+	thread* owner;
+	uint32_t depth;
+	wait_queue waiters;
+} mutex;
+
+//the code running now becomes thread 0, call once the heap is up
+void init_sched(char name[]);
+
+//returns 0x0 if there is no free slot, the thread returning from entry exits
+thread* thread_create(char name[], uint8_t priority, void (*entry)(void*), void* arg);
+//a program in its own address space (kernel/elf.h), the thread owns vm and destroys it when it exits
+thread* thread_create_process(char name[], uint8_t priority, uint32_t eip, uint32_t esp, struct vm_space* vm);
+thread* thread_current();
+void thread_yield();
+void thread_exit();
+void thread_sleep(uint32_t ticks); //on the timer wheel, the cpu idles without ticks meanwhile
+
+void thread_wait(wait_queue* q); //interrupts must be disabled
+void thread_wakeup(wait_queue* q); //wakes every waiter
+void thread_preempt(); //yields if a wakeup readied a more important thread, interrupts must be enabled
+
+void mutex_lock(mutex* m);
+void mutex_unlock(mutex* m);
+
+//called by irq_handler and the timer
+registers_t* schedule(registers_t* r);
+void sched_tick();
+
+void list_threads();
+
+#endif
@@ -0,0 +1,406 @@
+#include "shell.h"
+#include "elf.h"
+#include "filesystem.h"
+#include "fsbench.h"
+#include "log.h"
+#include "prof.h"
+#include "sched.h"
+#include "syscall.h"
+
+#include "../cpu/ports.h"
+#include "../cpu/smp.h"
+#include "../cpu/timer.h"
+#include "../drivers/ata.h"
+#include "../drivers/screen.h"
+#include "../libc/mem.h"
+#include "../libc/string.h"
+
+typedef struct {
+	char* name;
+	char* usage;
+	uint8_t args; //arguments required after the name
+	uint8_t flags;
+	void (*run)(int argc, char* argv[]);
+} shell_command;
+
+#define SHELL_FS 0x01 //runs holding fs_lock
+#define SHELL_NAME_LEN 16 //command name time keeps, terminator included
+
+static uint8_t script_depth = 0;
+
+static void cmd_end(int argc, char* argv[])
+{
+	kprint_color(RED_TEXT);
+	kprint("Stopping the CPU. Bye!\n");
+	log_drain(); //klogd won't get to run again
+
+	//qemu's isa-debug-exit device (make bench) quits here, nothing listens on this port otherwise
+	port_byte_out(0xf4, 0);
+	asm volatile("cli; hlt");
+}
+
+static void cmd_kclear(int argc, char* argv[])
+{
+	clear_screen();
+}
+
+static void cmd_dumph(int argc, char* argv[])
+{
+	#ifdef HEAP_DEBUG
+	dump_heap();
+	kprint_color(WHITE_ON_BLACK);
+	#endif
+}
+
+static void cmd_malloc(int argc, char* argv[])
+{
+	int ipt = stoi(argv[1]);
+	if (ipt <= 0) return;
+	void* adr = kmalloc(ipt);
+	kprint("Allocated at ");
+	kprint_color(RED_TEXT);
+	kprintf("0x%x\n", (uint32_t)adr);
+	kprint_color(WHITE_TEXT);
+}
+
+static void cmd_diskr(int argc, char* argv[])
+{
+	int lba = stoi(argv[1]);
+
+	uint8_t sectors = 1;
+	uint8_t* buf = kmalloc(512 * sectors);
+	lba_read(lba, sectors, buf);
+	kfree(buf);
+}
+
+static void cmd_ls(int argc, char* argv[])
+{
+	ls();
+}
+
+static void cmd_fsflush(int argc, char* argv[])
+{
+	save_state();
+}
+
+static void cmd_folder(int argc, char* argv[])
+{
+	create_folder(argv[1]);
+}
+
+static void cmd_cd(int argc, char* argv[])
+{
+	cd(argv[1]);
+}
+
+static void cmd_fsbench(int argc, char* argv[])
+{
+	char* n = argc > 1 ? argv[1] : "";
+	char* reps = argc > 2 ? argv[2] : "";
+	fsbench(stoi(n), stoi(reps));
+}
+
+static void cmd_file(int argc, char* argv[])
+{
+	create_file(argv[1]);
+}
+
+static void cmd_cat(int argc, char* argv[])
+{
+	cat(argv[1]);
+}
+
+static void cmd_write(int argc, char* argv[])
+{
+	//the text keeps its spaces
+	char* end = argv[argc - 1] + strlen(argv[argc - 1]);
+	for (char* c = argv[2]; c < end; c++)
+	{
+		if (*c == '\0') *c = ' ';
+	}
+	write_file(argv[1], argv[2]);
+}
+
+static void cmd_compress(int argc, char* argv[])
+{
+	compress_file(argv[1]);
+}
+
+static void cmd_dmesg(int argc, char* argv[])
+{
+	dmesg();
+}
+
+static void cmd_loglevel(int argc, char* argv[])
+{
+	set_log_level(stoi(argv[1]), stoi(argv[2]));
+}
+
+static void cmd_script(int argc, char* argv[])
+{
+	if (!run_script(argv[1])) no_such_file();
+}
+
+static void cmd_threads(int argc, char* argv[])
+{
+	list_threads();
+}
+
+static void cmd_sleep(int argc, char* argv[])
+{
+	thread_sleep(MS_TO_TICKS(stoi(argv[1])));
+}
+
+static void cmd_clock(int argc, char* argv[])
+{
+	kprintf("clock ns=%llu ticks=%u timer_irqs=%u tsc_khz=%u\n", clock_ns(), get_tick(), timer_irqs(), tsc_khz());
+}
+
+static void cmd_prof(int argc, char* argv[])
+{
+	if (strcmp(argv[1], "start") == 0)
+	{
+		uint32_t every = argc > 2 ? stoi(argv[2]) : 1;
+		if (!prof_start(every))
+		{
+			kprint_color(RED_TEXT);
+			kprint("Not enough memory for the profile.\n");
+			kprint_color(WHITE_ON_BLACK);
+		}
+	}
+	else if (strcmp(argv[1], "stop") == 0) prof_stop();
+	else if (strcmp(argv[1], "report") == 0) prof_report();
+}
+
+static void cmd_irqstat(int argc, char* argv[])
+{
+	if (argc > 1 && strcmp(argv[1], "reset") == 0) irq_stats_reset();
+	else print_irq_stats();
+}
+
+static void cmd_smp(int argc, char* argv[])
+{
+	int limit = argc > 1 ? stoi(argv[1]) : 0;
+	smp_bench(limit > 0 ? limit : SMP_BENCH_LIMIT);
+}
+
+static void cmd_syscall(int argc, char* argv[])
+{
+	syscall_bench();
+}
+
+static void cmd_run(int argc, char* argv[])
+{
+	thread* t = elf_run(argv[1], PRIORITY_NORMAL);
+	if (t != 0x0) kprintf("[%u] %s\n", t->id, t->name);
+}
+
+static void run_command(int argc, char* argv[]);
+
+static void cmd_time(int argc, char* argv[])
+{
+	//commands like write and cd rewrite their words in place
+	char name[SHELL_NAME_LEN];
+	int i = 0;
+	for (; i < SHELL_NAME_LEN - 1 && argv[1][i] != '\0'; i++) name[i] = argv[1][i];
+	name[i] = '\0';
+
+	uint32_t ticks = get_tick();
+	uint64_t cycles = rdtsc();
+
+	run_command(argc - 1, argv + 1);
+
+	cycles = rdtsc() - cycles;
+	ticks = get_tick() - ticks;
+	kprintf("time %s cycles=%llu ns=%llu ticks=%u\n", name, cycles, cycles_to_ns(cycles), ticks);
+}
+
+static void cmd_help(int argc, char* argv[]);
+
+static shell_command commands[] = {
+	{ "END", "END", 0, 0, cmd_end },
+	{ "kclear", "kclear", 0, 0, cmd_kclear },
+	{ "dumph", "dumph", 0, 0, cmd_dumph },
+	{ "malloc", "malloc <bytes>", 1, 0, cmd_malloc },
+	{ "diskr", "diskr <lba>", 1, SHELL_FS, cmd_diskr },
+	{ "ls", "ls", 0, SHELL_FS, cmd_ls },
+	{ "fsflush", "fsflush", 0, SHELL_FS, cmd_fsflush },
+	{ "folder", "folder <name>", 1, SHELL_FS, cmd_folder },
+	{ "cd", "cd <path>", 1, SHELL_FS, cmd_cd },
+	{ "fsbench", "fsbench [n] [reps]", 0, SHELL_FS, cmd_fsbench },
+	{ "file", "file <name>", 1, SHELL_FS, cmd_file },
+	{ "cat", "cat <file>", 1, SHELL_FS, cmd_cat },
+	{ "write", "write <file> <text>", 2, SHELL_FS, cmd_write },
+	{ "compress", "compress <file>", 1, SHELL_FS, cmd_compress },
+	{ "dmesg", "dmesg", 0, 0, cmd_dmesg },
+	{ "loglevel", "loglevel <console> <serial>", 2, 0, cmd_loglevel },
+	{ "script", "script <file>", 1, 0, cmd_script },
+	{ "time", "time <command>", 1, 0, cmd_time },
+	{ "threads", "threads", 0, 0, cmd_threads },
+	{ "sleep", "sleep <ms>", 1, 0, cmd_sleep },
+	{ "clock", "clock", 0, 0, cmd_clock },
+	{ "prof", "prof <start [ticks]|stop|report>", 1, 0, cmd_prof },
+	{ "irqstat", "irqstat [reset]", 0, 0, cmd_irqstat },
+	{ "smp", "smp [limit]", 0, 0, cmd_smp },
+	{ "syscall", "syscall", 0, 0, cmd_syscall },
+	{ "run", "run <file>", 1, 0, cmd_run },
+	{ "help", "help", 0, 0, cmd_help },
+};
+
+#define SHELL_COMMANDS (sizeof(commands) / sizeof(commands[0]))
+
+static void cmd_help(int argc, char* argv[])
+{
+	for (uint32_t i = 0; i < SHELL_COMMANDS; i++)
+	{
+		kprint(commands[i].usage);
+		kprint("\n");
+	}
+}
+
+static void run_command(int argc, char* argv[])
+{
+	for (uint32_t i = 0; i < SHELL_COMMANDS; i++)
+	{
+		if (strcmp(argv[0], commands[i].name) != 0) continue;
+
+		if (argc - 1 < commands[i].args)
+		{
+			kprint_color(RED_TEXT);
+			kprintf("usage: %s\n", commands[i].usage);
+			kprint_color(WHITE_ON_BLACK);
+			return;
+		}
+		if (commands[i].flags & SHELL_FS) mutex_lock(&fs_lock);
+		commands[i].run(argc, argv);
+		if (commands[i].flags & SHELL_FS) mutex_unlock(&fs_lock);
+		return;
+	}
+
+	kprint_color(RED_TEXT);
+	kprintf("Unknown command %s, help lists them.\n", argv[0]);
+	kprint_color(WHITE_ON_BLACK);
+}
+
+static void shell_job(void* line)
+{
+	parse_shell_command(line);
+	kfree(line);
+}
+
+//runs the line in its own thread, named after the command
+static void spawn_job(char* input)
+{
+	int len = strlen(input);
+	char* line = kmalloc(len + 1); //zeroed, strcpy doesn't terminate
+	if (line == 0x0) return;
+	strcpy(input, line);
+
+	char name[THREAD_NAME_LEN];
+	int i = 0;
+	for (; i < THREAD_NAME_LEN - 1 && input[i] != ' ' && input[i] != '\0'; i++) name[i] = input[i];
+	name[i] = '\0';
+
+	thread* job = thread_create(name, PRIORITY_LOW, shell_job, line);
+	if (job == 0x0)
+	{
+		kfree(line);
+		kprint_color(RED_TEXT);
+		kprint("No free thread.\n");
+		kprint_color(WHITE_ON_BLACK);
+		return;
+	}
+	kprintf("[%u] %s\n", job->id, line);
+}
+
+void parse_shell_command(char* input)
+{
+	char* argv[SHELL_MAX_ARGS];
+	int argc = 0;
+
+	while (*input == ' ') input++;
+	char* last = input + strlen(input);
+	while (last > input && last[-1] == ' ') last--;
+	if (last > input && last[-1] == '&')
+	{
+		last[-1] = '\0';
+		spawn_job(input);
+		return;
+	}
+
+	//splits in place, repeated spaces don't make empty words
+	while (*input != '\0' && argc < SHELL_MAX_ARGS)
+	{
+		while (*input == ' ') *input++ = '\0';
+		if (*input == '\0') break;
+
+		argv[argc++] = input;
+		if (argc == SHELL_MAX_ARGS) break;
+		while (*input != ' ' && *input != '\0') input++;
+	}
+
+	if (argc == 0) return;
+	run_command(argc, argv);
+}
+
+int run_script(char path[])
+{
+	mutex_lock(&fs_lock);
+	fs_index file = fs_open(path);
+	if (file == FS_NONE)
+	{
+		mutex_unlock(&fs_lock);
+		return 0;
+	}
+
+	if (script_depth >= SCRIPT_MAX_DEPTH)
+	{
+		mutex_unlock(&fs_lock);
+		kprint_color(RED_TEXT);
+		kprint("Scripts nested too deep.\n");
+		kprint_color(WHITE_ON_BLACK);
+		return 1;
+	}
+
+	//copied out of the page cache, the commands may evict or rewrite the file
+	uint32_t size = fs_size(file);
+	char* text = kmalloc(size + 1);
+	uint32_t len = 0;
+	for (uint32_t pg = 0; len < size; pg++)
+	{
+		pcache_page* page = fs_map(file, pg);
+		if (page == 0x0) break;
+
+		uint32_t n = size - len;
+		if (n > PCACHE_PAGE_SIZE) n = PCACHE_PAGE_SIZE;
+		memcpy(page->data, text + len, n);
+		len += n;
+		pcache_put(page);
+	}
+	text[len] = '\0';
+	mutex_unlock(&fs_lock);
+
+	script_depth++;
+	char* line = text;
+	while (line < text + len)
+	{
+		char* next = line;
+		while (*next != '\n' && *next != '\0') next++;
+		*next = '\0';
+		if (next > line && next[-1] == '\r') next[-1] = '\0';
+
+		if (line[0] != '\0' && line[0] != '#')
+		{
+			//echoed so a captured serial log shows which command printed what
+			kprint("> ");
+			kprint(line);
+			kprint("\n");
+			parse_shell_command(line);
+		}
+		line = next + 1;
+	}
+	script_depth--;
+
+	kfree(text);
+	return 1;
+}
@@ -0,0 +1,23 @@
+#ifndef SHELL_H
+#define SHELL_H
+
+/* Shell
+a line is split on spaces into words, the first word picks the command from a table.
+"time <command>" runs the command and prints its rdtsc, nanosecond and tick deltas.
+"script <file>" runs a file line by line, empty lines and lines starting with # are skipped.
+a line ending in & runs in a new thread at PRIORITY_LOW, the shell takes the next line right away.
+commands that use the filesystem or the disk run holding fs_lock.
+*/
+
+#define SHELL_MAX_ARGS 16 //words past this stay in the last argument
+#define SCRIPT_MAX_DEPTH 4 //scripts running scripts
+
+//file run at boot if it exists in the root folder
+#define SHELL_AUTORUN "autorun"
+
+void parse_shell_command(char* input);
+
+//returns 0 if the file doesn't exist
+int run_script(char path[]);
+
+#endif
@@ -0,0 +1,183 @@
+#include "syscall.h"
+#include "elf.h"
+#include "filesystem.h"
+#include "sched.h"
+
+#include "../cpu/cpuid.h"
+#include "../cpu/gdt.h"
+#include "../cpu/idt.h"
+#include "../cpu/paging.h"
+#include "../cpu/timer.h"
+#include "../drivers/screen.h"
+#include "../libc/mem.h"
+#include "../libc/string.h"
+
+#define MSR_SYSENTER_CS 0x174
+#define MSR_SYSENTER_ESP 0x175
+#define MSR_SYSENTER_EIP 0x176
+
+extern void isr_syscall();
+extern void sysenter_entry();
+
+static uint8_t sysenter = 0;
+
+void init_syscalls()
+{
+	set_idt_user_gate(IRQ_SYSCALL, (uint32_t)isr_syscall);
+	if (!cpu_sysenter()) return;
+
+	//esp comes from the tss, the scheduler keeps its esp0 at the running thread's kernel stack
+	wrmsr(MSR_SYSENTER_CS, KERNEL_CS);
+	wrmsr(MSR_SYSENTER_ESP, (uint32_t)tss_stack(0));
+	wrmsr(MSR_SYSENTER_EIP, (uint32_t)sysenter_entry);
+	sysenter = 1;
+}
+
+int sysenter_supported()
+{
+	return sysenter;
+}
+
+//ring 3 buffers have to be in the user window, below it are the kernel and the page cache
+static int user_range(void* ptr, uint32_t len)
+{
+	uint32_t addr = (uint32_t)ptr;
+	return addr >= USER_BASE && addr <= USER_END && len <= USER_END - addr;
+}
+
+static int user_string(char* s)
+{
+	if (!user_range(s, 0)) return 0;
+	for (char* c = s; (uint32_t)c < USER_END; c++)
+	{
+		if (*c == '\0') return 1;
+	}
+	return 0;
+}
+
+//kernel copy of a user string, kfree it, 0x0 if it isn't one
+//user memory can fault (a page in or a kill), so it is only touched without locks held
+//user_string touches every byte before anything is allocated
+static char* user_strdup(char* s)
+{
+	if (!user_string(s)) return 0x0;
+	uint32_t len = strlen(s);
+	char* copy = kmalloc(len + 1); //zeroed, memcpy doesn't terminate
+	if (copy != 0x0) memcpy(s, copy, len);
+	return copy;
+}
+
+static uint32_t sys_write(char* text, uint32_t len)
+{
+	if (!user_range(text, len)) return SYS_ERROR;
+
+	char chunk[65];
+	for (uint32_t done = 0; done < len;)
+	{
+		uint32_t n = len - done;
+		if (n > sizeof(chunk) - 1) n = sizeof(chunk) - 1;
+		memcpy(text + done, chunk, n);
+		chunk[n] = '\0';
+		kprint(chunk);
+		done += n;
+	}
+	return len;
+}
+
+//reads through a kernel buffer, copied out after fs_lock is dropped
+static uint32_t sys_read_file(char* path, uint8_t* buf, uint32_t size)
+{
+	if (!user_range(buf, size)) return SYS_ERROR;
+	char* kpath = user_strdup(path);
+	if (kpath == 0x0) return SYS_ERROR;
+
+	mutex_lock(&fs_lock);
+	fs_index file = fs_open(kpath);
+	uint32_t len = file == FS_NONE ? 0 : fs_size(file);
+	mutex_unlock(&fs_lock);
+	kfree(kpath);
+	if (file == FS_NONE) return SYS_ERROR;
+
+	//on the stack, a fault while copying out kills the thread and nothing may be left allocated
+	//the index stays valid, init_filesystem doesn't remount under a program (vm_maps)
+	uint8_t chunk[512];
+	if (len > size) len = size;
+	uint32_t read = 0;
+	while (read < len)
+	{
+		uint32_t off = read % PCACHE_PAGE_SIZE;
+		uint32_t n = len - read;
+		if (n > sizeof(chunk)) n = sizeof(chunk);
+
+		mutex_lock(&fs_lock);
+		pcache_page* page = fs_map(file, read / PCACHE_PAGE_SIZE);
+		if (page != 0x0)
+		{
+			memcpy(page->data + off, chunk, n);
+			pcache_put(page);
+		}
+		mutex_unlock(&fs_lock);
+		if (page == 0x0) break;
+
+		memcpy(chunk, buf + read, n);
+		read += n;
+	}
+	return read;
+}
+
+static uint32_t sys_write_file(char* path, char* text)
+{
+	//both are checked (and paged in) before either copy is allocated
+	if (!user_string(path) || !user_string(text)) return SYS_ERROR;
+	char* kpath = user_strdup(path);
+	char* ktext = user_strdup(text);
+	if (kpath != 0x0 && ktext != 0x0)
+	{
+		mutex_lock(&fs_lock);
+		write_file(kpath, ktext);
+		mutex_unlock(&fs_lock);
+	}
+	uint32_t ret = kpath != 0x0 && ktext != 0x0 ? 0 : SYS_ERROR;
+	kfree(kpath);
+	kfree(ktext);
+	return ret;
+}
+
+uint32_t syscall_dispatch(uint32_t n, uint32_t a, uint32_t b, uint32_t c)
+{
+	switch (n)
+	{
+		case SYS_EXIT:
+			thread_exit();
+			return 0;
+		case SYS_WRITE:
+			return sys_write((char*)a, b);
+		case SYS_READ_FILE:
+			return sys_read_file((char*)a, (uint8_t*)b, c);
+		case SYS_WRITE_FILE:
+			return sys_write_file((char*)a, (char*)b);
+		case SYS_TICKS:
+			return get_tick();
+		case SYS_SLEEP:
+			thread_sleep(MS_TO_TICKS(a));
+			return 0;
+		case SYS_THREAD:
+			return thread_current()->id;
+	}
+	return SYS_ERROR;
+}
+
+void syscall_handler(registers_t* r)
+{
+	r->eax = syscall_dispatch(r->eax, r->ebx, r->esi, r->edi);
+}
+
+void syscall_bench()
+{
+	char path[] = "/sysbench.elf";
+	thread* t = elf_run(path, PRIORITY_NORMAL);
+	if (t == 0x0) return;
+
+	//thread ids are slots, the slot is free again once the program is gone
+	while (t->state != THREAD_DEAD && t->state != THREAD_FREE) thread_sleep(1);
+}
@@ -0,0 +1,57 @@
+#ifndef SYSCALL_H
+#define SYSCALL_H
+
+#include <stdint.h>
+#include "../cpu/isr.h"
+
+/* System calls
+programs (kernel/elf.h) get kernel services through int 0x80 or, when the cpu has it,
+the SYSENTER fast path, which skips the interrupt frame and the segment reloads.
+both take the number in eax and up to three arguments in ebx, esi and edi, the result comes back in eax.
+pointers from ring 3 have to lie in the user window (cpu/paging.h) or the call fails with SYS_ERROR,
+a program's pages are mapped while it is in the kernel (a page it hasn't touched yet faults in like it would in ring 3).
+a bad page inside the window ends the program like a fault in ring 3 would.
+*/
+
+#define SYS_EXIT 0
+#define SYS_WRITE 1 //(text, len) to the console
+#define SYS_READ_FILE 2 //(path, buf, size) from the start of the file, bytes read or SYS_ERROR
+#define SYS_WRITE_FILE 3 //(path, text)
+#define SYS_TICKS 4
+#define SYS_SLEEP 5 //(ms)
+#define SYS_THREAD 6 //id of the calling thread
+#define SYS_CALLS 7
+
+#define SYS_ERROR 0xffffffff
+
+#define SYSCALL_BENCH_CALLS 100000 //per path, tools/sysbench.c
+
+void init_syscalls(); //the int 0x80 gate and the SYSENTER msrs of the boot cpu
+int sysenter_supported();
+
+uint32_t syscall_dispatch(uint32_t n, uint32_t a, uint32_t b, uint32_t c);
+void syscall_handler(registers_t* r); //int 0x80, from isr_handler
+
+void syscall_bench(); //runs /sysbench.elf (round trip cycles of both paths) and waits for it
+
+//called from ring 3
+static inline uint32_t user_syscall(uint32_t n, uint32_t a, uint32_t b, uint32_t c)
+{
+	uint32_t ret;
+	asm volatile("int $0x80" : "=a" (ret) : "a" (n), "b" (a), "S" (b), "D" (c) : "memory");
+	return ret;
+}
+
+//sysexit returns to edx with the stack in ecx
+static inline uint32_t user_sysenter(uint32_t n, uint32_t a, uint32_t b, uint32_t c)
+{
+	uint32_t ret;
+	asm volatile("mov %%esp, %%ecx\n"
+		"movl $1f, %%edx\n"
+		"sysenter\n"
+		"1:\n"
+		: "=a" (ret) : "a" (n), "b" (a), "S" (b), "D" (c) : "ecx", "edx", "memory");
+	return ret;
+}
+
+#endif
@@ -0,0 +1,118 @@
+#include "timers.h"
+
+#include "../cpu/isr.h"
+
+static ktimer* wheel[TW_LEVELS][TW_SLOTS];
+static uint32_t wheel_tick = 0; //next tick to run
+static uint32_t upper = 0; //timers above level 0, they need a cascade before they can run
+
+static void wheel_unlink(ktimer* t)
+{
+	*t->pprev = t->next;
+	if (t->next != 0x0) t->next->pprev = t->pprev;
+	t->next = 0x0;
+	t->pprev = 0x0;
+	if (t->level > 0) upper--;
+}
+
+//picks the level from how far away the timer is, the slot from its expiry
+static void wheel_insert(ktimer* t)
+{
+	uint32_t delta = t->expires - wheel_tick;
+	if ((int32_t)delta < 0)
+	{
+		t->expires = wheel_tick;
+		delta = 0;
+	}
+
+	uint32_t span = 1u << (TW_BITS * TW_LEVELS);
+	if (delta >= span)
+	{
+		delta = span - 1;
+		t->expires = wheel_tick + delta;
+	}
+
+	uint8_t level = 0;
+	while (level < TW_LEVELS - 1 && delta >= (1u << (TW_BITS * (level + 1)))) level++;
+
+	ktimer** head = &wheel[level][(t->expires >> (TW_BITS * level)) & TW_MASK];
+	t->next = *head;
+	if (*head != 0x0) (*head)->pprev = &t->next;
+	*head = t;
+	t->pprev = head;
+	t->level = level;
+	if (level > 0) upper++;
+}
+
+//moves the timers of one slot down, they are all less than a slot of this level away now
+static void cascade(uint8_t level, uint32_t index)
+{
+	ktimer* t;
+	while ((t = wheel[level][index]) != 0x0)
+	{
+		wheel_unlink(t);
+		wheel_insert(t);
+	}
+}
+
+void init_timers(uint32_t now)
+{
+	wheel_tick = now + 1;
+}
+
+void timer_add(ktimer* t, uint32_t ticks, void (*fn)(void*), void* arg)
+{
+	uint32_t flags = irq_save();
+	if (t->pprev != 0x0) wheel_unlink(t);
+
+	t->fn = fn;
+	t->arg = arg;
+	t->expires = wheel_tick - 1 + ticks;
+	wheel_insert(t);
+	irq_restore(flags);
+}
+
+int timer_cancel(ktimer* t)
+{
+	uint32_t flags = irq_save();
+	int pending = t->pprev != 0x0;
+	if (pending) wheel_unlink(t);
+	irq_restore(flags);
+	return pending;
+}
+
+void timers_run(uint32_t now)
+{
+	while ((int32_t)(now - wheel_tick) >= 0)
+	{
+		//a wrap of level 0 cascades the next slot of level 1, a wrap of that the next of level 2...
+		uint32_t index = wheel_tick & TW_MASK;
+		for (uint8_t level = 1; index == 0 && level < TW_LEVELS; level++)
+		{
+			index = (wheel_tick >> (TW_BITS * level)) & TW_MASK;
+			cascade(level, index);
+		}
+
+		//timers added by the callbacks land on later ticks
+		ktimer** slot = &wheel[0][wheel_tick & TW_MASK];
+		wheel_tick++;
+
+		ktimer* t;
+		while ((t = *slot) != 0x0)
+		{
+			wheel_unlink(t);
+			t->fn(t->arg);
+		}
+	}
+}
+
+uint32_t timers_next()
+{
+	for (uint32_t i = 0; i < TW_SLOTS; i++)
+	{
+		uint32_t tick = wheel_tick + i;
+		if ((tick & TW_MASK) == 0 && upper != 0) return i + 1; //has to cascade
+		if (wheel[0][tick & TW_MASK] != 0x0) return i + 1;
+	}
+	return upper != 0 ? TW_SLOTS : TIMERS_NONE;
+}
@@ -0,0 +1,41 @@
+#ifndef TIMERS_H
+#define TIMERS_H
+
+#include <stdint.h>
+
+/* Kernel timers
+a hierarchical timer wheel in ticks (cpu/timer.h, TIMER_HZ).
+level 0 has a slot for each of the next TW_SLOTS ticks, every level above covers TW_SLOTS times
+the range of the one below and is moved down a level (cascaded) whenever the level below wraps.
+adding and cancelling are O(1), every tick only looks at one slot.
+timeouts longer than the wheel (TW_SLOTS^TW_LEVELS ticks) are cut to the longest it holds.
+
+callbacks run in the timer interrupt, with interrupts disabled.
+*/
+
+#define TW_BITS 6
+#define TW_SLOTS (1 << TW_BITS)
+#define TW_MASK (TW_SLOTS - 1)
+#define TW_LEVELS 4
+
+#define TIMERS_NONE 0xffffffff
+
+typedef struct ktimer {
+	uint32_t expires; //tick
+	void (*fn)(void* arg);
+	void* arg;
+	struct ktimer* next;
+	struct ktimer** pprev; //0x0 when the timer isn't pending
+	uint8_t level;
+} ktimer;
+
+void init_timers(uint32_t now);
+
+//fn(arg) runs ticks from now, re-adding a pending timer moves it
+void timer_add(ktimer* t, uint32_t ticks, void (*fn)(void*), void* arg);
+int timer_cancel(ktimer* t); //1 if the timer was still pending
+
+void timers_run(uint32_t now); //runs every timer that expired up to now, called each tick
+uint32_t timers_next(); //ticks until the wheel has work, TIMERS_NONE if it is empty
+
+#endif
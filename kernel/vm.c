@@ -0,0 +1,168 @@
+#include "vm.h"
+#include "filesystem.h"
+#include "sched.h"
+
+#include "../libc/mem.h"
+
+#define FAULT_PRESENT 0x01 //in the error code, set when the page was mapped and the access not allowed
+
+static vm_space* spaces = 0x0; //every live space, under fs_lock
+static uint16_t shared_pins = 0; //page cache references held by all spaces, under fs_lock
+
+vm_space* vm_create(fs_index file)
+{
+	if (!paging_enabled()) return 0x0;
+
+	vm_space* vm = kmalloc(sizeof(vm_space)); //zeroed
+	if (vm == 0x0) return 0x0;
+
+	vm->pd = pd_create();
+	if (vm->pd == 0x0)
+	{
+		kfree(vm);
+		return 0x0;
+	}
+	vm->file = file;
+	vm->next = spaces;
+	spaces = vm;
+	return vm;
+}
+
+int vm_maps(fs_index file)
+{
+	for (vm_space* vm = spaces; vm != 0x0; vm = vm->next)
+	{
+		if (file == FS_NONE || vm->file == file) return 1;
+	}
+	return 0;
+}
+
+int vm_add_area(vm_space* vm, uint32_t start, uint32_t end, uint32_t offset, uint32_t file_end, uint8_t flags)
+{
+	if (vm->areas_used >= VM_AREAS || start >= end) return 0;
+	for (uint8_t i = 0; i < vm->areas_used; i++)
+	{
+		if (start < vm->areas[i].end && vm->areas[i].start < end) return 0;
+	}
+
+	vm_area* a = &vm->areas[vm->areas_used++];
+	a->start = start;
+	a->end = end;
+	a->offset = offset;
+	a->file_end = file_end;
+	a->flags = flags;
+	return 1;
+}
+
+static void free_page(uint32_t vaddr, uint32_t pte, void* arg)
+{
+	if (!(pte & PTE_SHARED)) frame_free(pte & PAGE_MASK);
+}
+
+void vm_destroy(vm_space* vm)
+{
+	//the directory can't be freed while it is loaded
+	thread_current()->cr3 = 0;
+	paging_switch(0);
+
+	pd_walk(vm->pd, free_page, 0x0);
+	pd_destroy(vm->pd);
+
+	mutex_lock(&fs_lock);
+	for (uint8_t i = 0; i < vm->shared_used; i++) pcache_put(vm->shared[i]);
+	shared_pins -= vm->shared_used;
+	vm_space** link = &spaces;
+	while (*link != vm) link = &(*link)->next;
+	*link = vm->next;
+	mutex_unlock(&fs_lock);
+	kfree(vm);
+}
+
+static vm_area* find_area(vm_space* vm, uint32_t addr)
+{
+	for (uint8_t i = 0; i < vm->areas_used; i++)
+	{
+		if (addr >= vm->areas[i].start && addr < vm->areas[i].end) return &vm->areas[i];
+	}
+	return 0x0;
+}
+
+//the page cache frame if the page can be shared, fs_lock is held
+static uint32_t map_shared(vm_space* vm, vm_area* a, uint32_t page)
+{
+	if ((a->flags & VM_WRITE) || page + PAGE_SIZE > a->file_end) return 0;
+	if (vm->shared_used >= VM_SHARED || shared_pins >= VM_SHARED_MAX) return 0;
+
+	pcache_page* p = fs_map(vm->file, (a->offset + page - a->start) / PCACHE_PAGE_SIZE);
+	if (p == 0x0) return 0;
+	if ((uint32_t)p->data & ~PAGE_MASK) //kmalloc'd when frames ran out
+	{
+		pcache_put(p);
+		return 0;
+	}
+
+	vm->shared[vm->shared_used++] = p;
+	shared_pins++;
+	return (uint32_t)p->data;
+}
+
+//copies the file's part of the page into a fresh frame, fs_lock is held
+static uint32_t map_copy(vm_space* vm, vm_area* a, uint32_t page)
+{
+	uint32_t frame = frame_alloc(); //zeroed
+	if (frame == 0) return 0;
+
+	uint32_t end = page + PAGE_SIZE;
+	if (end > a->file_end) end = a->file_end;
+	for (uint32_t addr = page; addr < end;)
+	{
+		uint32_t off = a->offset + addr - a->start;
+		pcache_page* p = fs_map(vm->file, off / PCACHE_PAGE_SIZE);
+		if (p == 0x0)
+		{
+			frame_free(frame);
+			return 0;
+		}
+
+		uint32_t n = PCACHE_PAGE_SIZE - off % PCACHE_PAGE_SIZE;
+		if (n > end - addr) n = end - addr;
+		memcpy(p->data + off % PCACHE_PAGE_SIZE, (uint8_t*)frame + addr - page, n);
+		pcache_put(p);
+		addr += n;
+	}
+	return frame;
+}
+
+int vm_fault(registers_t* r)
+{
+	uint32_t addr = read_cr2(); //before anything else can fault
+	vm_space* vm = thread_current()->vm;
+	if (vm == 0x0 || (r->err_code & FAULT_PRESENT)) return 0;
+
+	vm_area* a = find_area(vm, addr);
+	if (a == 0x0) return 0;
+
+	//reading the file may have to wait for the disk
+	if (r->eflags & 0x200) asm volatile("sti");
+
+	uint32_t page = addr & PAGE_MASK;
+	uint32_t flags = PTE_USER | ((a->flags & VM_WRITE) ? PTE_WRITE : 0);
+	uint32_t frame = 0;
+	if ((a->flags & VM_FILE) && page < a->file_end)
+	{
+		mutex_lock(&fs_lock);
+		frame = map_shared(vm, a, page);
+		if (frame != 0) flags |= PTE_SHARED;
+		else frame = map_copy(vm, a, page);
+		mutex_unlock(&fs_lock);
+	}
+	else frame = frame_alloc();
+
+	if (frame == 0) return 0;
+	if (!page_map(vm->pd, page, frame, flags))
+	{
+		if (!(flags & PTE_SHARED)) frame_free(frame);
+		return 0;
+	}
+	return 1;
+}
@@ -0,0 +1,61 @@
+#ifndef VM_H
+#define VM_H
+
+#include <stdint.h>
+#include "filesystem.h"
+#include "../cpu/isr.h"
+#include "../cpu/paging.h"
+
+/* Program address spaces
+a program (kernel/elf.h) lives in the user window of a page directory of its own (cpu/paging.h).
+nothing is mapped up front, vm_fault maps each page of an area the first time it is touched:
+file pages are read through the page cache, the stack and bss are zeroed frames.
+read only pages wholly inside the file map the page cache frame itself, so every instance of a
+program shares them (the page stays referenced until the program exits), the rest are private copies.
+at most VM_SHARED_MAX such references exist at once, so programs can't pin the whole cache.
+so the shared pages never change under a program, a mapped file can't be written, packed or remounted (vm_maps).
+spaces are created and destroyed holding fs_lock.
+*/
+
+#define VM_AREAS 8
+#define VM_SHARED 16 //page cache pages one program may hold, beyond that it gets copies
+#define VM_SHARED_MAX (PCACHE_PAGES / 4) //held by all programs together, the rest of the cache stays evictable
+
+#define VM_STACK_TOP USER_END
+#define VM_STACK_SIZE 0x10000
+
+#define VM_WRITE 0x01
+#define VM_FILE 0x02
+
+typedef struct {
+	uint32_t start; //page aligned
+	uint32_t end;
+	uint32_t offset; //file offset of start
+	uint32_t file_end; //the file backs [start, file_end), the rest reads as zeros
+	uint8_t flags;
+} vm_area;
+
+typedef struct vm_space {
+	uint32_t pd;
+	fs_index file;
+	uint8_t areas_used;
+	uint8_t shared_used;
+	vm_area areas[VM_AREAS];
+	pcache_page* shared[VM_SHARED];
+	struct vm_space* next;
+} vm_space;
+
+//0x0 without paging or frames
+vm_space* vm_create(fs_index file);
+//0 if the area overlaps another one or there is no room left
+int vm_add_area(vm_space* vm, uint32_t start, uint32_t end, uint32_t offset, uint32_t file_end, uint8_t flags);
+//frees the pages of the running thread's space and switches back to the kernel directory
+void vm_destroy(vm_space* vm);
+
+//1 if a program maps the file, FS_NONE asks whether any program runs at all, fs_lock is held
+int vm_maps(fs_index file);
+
+//page faults (isr_handler), 1 if the page is mapped now
+int vm_fault(registers_t* r);
+
+#endif
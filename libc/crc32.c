@@ -0,0 +1,68 @@
+#include "crc32.h"
+#include "../cpu/cpuid.h"
+
+#define CRC32C_POLY 0x82F63B78 /* reversed 0x1EDC6F41 */
+
+/* slicing-by-8: table[k][b] is the crc of byte b followed by k zero bytes */
+static uint32_t crc_table[8][256];
+static uint8_t crc_ready = 0;
+static uint8_t crc_hw = 0;
+
+static void crc32c_init() {
+    int i, k;
+    for (i = 0; i < 256; i++) {
+        uint32_t c = i;
+        for (k = 0; k < 8; k++) c = (c & 1) ? (c >> 1) ^ CRC32C_POLY : c >> 1;
+        crc_table[0][i] = c;
+    }
+    for (i = 0; i < 256; i++)
+        for (k = 1; k < 8; k++)
+            crc_table[k][i] = (crc_table[k-1][i] >> 8) ^ crc_table[0][crc_table[k-1][i] & 0xFF];
+
+    uint32_t a, b, c, d;
+    cpuid(1, &a, &b, &c, &d);
+    crc_hw = (c & CPUID_ECX_SSE42) != 0;
+    crc_ready = 1;
+}
+
+static uint32_t crc32c_hw(uint32_t crc, uint8_t *p, uint32_t len) {
+    while (len >= 4) {
+        asm("crc32l %1, %0" : "+r" (crc) : "rm" (*(uint32_t*)p));
+        p += 4;
+        len -= 4;
+    }
+    while (len--) {
+        asm("crc32b %1, %0" : "+r" (crc) : "rm" (*p));
+        p++;
+    }
+    return crc;
+}
+
+static uint32_t crc32c_sw(uint32_t crc, uint8_t *p, uint32_t len) {
+    /* align to 4 so the 8 byte steps are two aligned loads */
+    while (len && ((uint32_t)p & 3)) {
+        crc = crc_table[0][(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+        len--;
+    }
+    while (len >= 8) {
+        uint32_t one = *(uint32_t*)p ^ crc;
+        uint32_t two = *(uint32_t*)(p + 4);
+        crc = crc_table[7][one & 0xFF] ^ crc_table[6][(one >> 8) & 0xFF] ^
+              crc_table[5][(one >> 16) & 0xFF] ^ crc_table[4][one >> 24] ^
+              crc_table[3][two & 0xFF] ^ crc_table[2][(two >> 8) & 0xFF] ^
+              crc_table[1][(two >> 16) & 0xFF] ^ crc_table[0][two >> 24];
+        p += 8;
+        len -= 8;
+    }
+    while (len--) crc = crc_table[0][(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+    return crc;
+}
+
+uint32_t crc32c(uint32_t crc, void *data, uint32_t len) {
+    if (!crc_ready) crc32c_init();
+
+    crc = ~crc;
+    if (crc_hw) crc = crc32c_hw(crc, (uint8_t*)data, len);
+    else crc = crc32c_sw(crc, (uint8_t*)data, len);
+    return ~crc;
+}
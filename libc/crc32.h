@@ -0,0 +1,10 @@
+#ifndef CRC32_H
+#define CRC32_H
+
+#include <stdint.h>
+
+/* CRC32C (Castagnoli), the same polynomial as the SSE4.2 crc32 instruction.
+ * Start with crc = 0 and pass the previous result to continue over more data. */
+uint32_t crc32c(uint32_t crc, void *data, uint32_t len);
+
+#endif
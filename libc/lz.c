@@ -0,0 +1,138 @@
+#include "lz.h"
+
+#define LZ_MIN_MATCH 4
+#define LZ_LAST_LITERALS 5 /* a block always ends with a few literals */
+#define LZ_HASH_BITS 12
+
+static uint16_t lz_table[1 << LZ_HASH_BITS];
+
+static inline uint32_t lz_read32(uint8_t *p) {
+    return *(uint32_t*)p; /* x86 doesn't mind unaligned loads */
+}
+
+static inline uint32_t lz_hash(uint32_t seq) {
+    return (seq * 2654435761u) >> (32 - LZ_HASH_BITS);
+}
+
+/* writes the 255 continuation bytes of a length, returns 0 if they don't fit */
+static int lz_put_length(uint8_t *dst, uint32_t *op, uint32_t cap, uint32_t n) {
+    while (n >= 255) {
+        if (*op >= cap) return 0;
+        dst[(*op)++] = 255;
+        n -= 255;
+    }
+    if (*op >= cap) return 0;
+    dst[(*op)++] = n;
+    return 1;
+}
+
+static int lz_put_literals(uint8_t *src, uint32_t lit, uint8_t *dst, uint32_t *op, uint32_t cap, uint8_t *token) {
+    *token = (lit >= 15 ? 15 : lit) << 4;
+    if (lit >= 15 && !lz_put_length(dst, op, cap, lit - 15)) return 0;
+    if (*op + lit > cap) return 0;
+
+    uint32_t i;
+    for (i = 0; i < lit; i++) dst[*op + i] = src[i];
+    *op += lit;
+    return 1;
+}
+
+uint32_t lz_compress(uint8_t *src, uint32_t len, uint8_t *dst, uint32_t cap) {
+    uint32_t ip = 0, anchor = 0, op = 0;
+    uint32_t i;
+    for (i = 0; i < (1 << LZ_HASH_BITS); i++) lz_table[i] = 0;
+
+    if (len > 0xFFFF) return 0;
+
+    while (ip + LZ_MIN_MATCH + LZ_LAST_LITERALS <= len) {
+        uint32_t seq = lz_read32(src + ip);
+        uint32_t h = lz_hash(seq);
+        uint32_t cand = lz_table[h];
+        lz_table[h] = ip;
+
+        if (cand >= ip || lz_read32(src + cand) != seq) {
+            ip++;
+            continue;
+        }
+
+        uint32_t mlen = LZ_MIN_MATCH;
+        while (ip + mlen < len - LZ_LAST_LITERALS && src[cand + mlen] == src[ip + mlen]) mlen++;
+
+        if (op >= cap) return 0;
+        uint32_t tokenpos = op++;
+        uint8_t token;
+        if (!lz_put_literals(src + anchor, ip - anchor, dst, &op, cap, &token)) return 0;
+
+        if (op + 2 > cap) return 0;
+        dst[op++] = (ip - cand) & 0xFF;
+        dst[op++] = (ip - cand) >> 8;
+
+        uint32_t ml = mlen - LZ_MIN_MATCH;
+        token |= ml >= 15 ? 15 : ml;
+        if (ml >= 15 && !lz_put_length(dst, &op, cap, ml - 15)) return 0;
+        dst[tokenpos] = token;
+
+        ip += mlen;
+        anchor = ip;
+    }
+
+    if (op >= cap) return 0;
+    uint32_t tokenpos = op++;
+    uint8_t token;
+    if (!lz_put_literals(src + anchor, len - anchor, dst, &op, cap, &token)) return 0;
+    dst[tokenpos] = token;
+    return op;
+}
+
+int lz_decompress(uint8_t *src, uint32_t clen, uint8_t *dst, uint32_t cap) {
+    uint32_t ip = 0, op = 0;
+    while (ip < clen) {
+        uint8_t token = src[ip++];
+
+        uint32_t lit = token >> 4;
+        if (lit == 15) {
+            uint8_t b;
+            do {
+                if (ip >= clen) return -1;
+                b = src[ip++];
+                lit += b;
+            } while (b == 255);
+        }
+        if (ip + lit > clen || op + lit > cap) return -1;
+
+        /* word copies first, literals are often long */
+        uint32_t i = 0;
+        for (; i + 4 <= lit; i += 4) *(uint32_t*)(dst + op + i) = *(uint32_t*)(src + ip + i);
+        for (; i < lit; i++) dst[op + i] = src[ip + i];
+        ip += lit;
+        op += lit;
+
+        if (ip == clen) break; /* the last sequence has no match */
+
+        if (ip + 2 > clen) return -1;
+        uint32_t offset = src[ip] | (src[ip + 1] << 8);
+        ip += 2;
+        if (offset == 0 || offset > op) return -1;
+
+        uint32_t mlen = token & 15;
+        if (mlen == 15) {
+            uint8_t b;
+            do {
+                if (ip >= clen) return -1;
+                b = src[ip++];
+                mlen += b;
+            } while (b == 255);
+        }
+        mlen += LZ_MIN_MATCH;
+        if (op + mlen > cap) return -1;
+
+        /* overlapping matches (offset < 4) repeat a short pattern, copy those byte by byte */
+        uint8_t *from = dst + op - offset;
+        i = 0;
+        if (offset >= 4)
+            for (; i + 4 <= mlen; i += 4) *(uint32_t*)(dst + op + i) = *(uint32_t*)(from + i);
+        for (; i < mlen; i++) dst[op + i] = from[i];
+        op += mlen;
+    }
+    return op;
+}
@@ -0,0 +1,18 @@
+#ifndef LZ_H
+#define LZ_H
+
+#include <stdint.h>
+
+/* LZ4 style block compression
+ * a block is a list of sequences: token (4 bit literal length, 4 bit match length - 4),
+ * optional length bytes, literals, 2 byte offset, optional match length bytes.
+ * the last sequence only has literals. Blocks are limited to 64 KiB.
+ * lz.c only depends on stdint so the host tools can build it too. */
+
+/* returns the compressed size or 0 if it doesn't fit in cap bytes */
+uint32_t lz_compress(uint8_t *src, uint32_t len, uint8_t *dst, uint32_t cap);
+
+/* returns the decompressed size or -1 for a corrupt block */
+int lz_decompress(uint8_t *src, uint32_t clen, uint8_t *dst, uint32_t cap);
+
+#endif
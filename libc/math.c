@@ -1,12 +1,14 @@
 #include "math.h"
 
+//square and multiply, integers only (the FPU is never set up)
 int pow(int base, int exp)
 {
-	if (exp == 0)
-		return 1;
-	
-	if (exp % 2 == 0)
-		return pow(base, exp * 0.5) * pow(base, exp * 0.5);
-		
-	return base * pow(base, exp *0.5) * pow(base, exp * 0.5);
+	int result = 1;
+	while (exp > 0)
+	{
+		if (exp & 1) result *= base;
+		base *= base;
+		exp >>= 1;
+	}
+	return result;
 }
@@ -1,4 +1,5 @@
 #include "mem.h"
+#include "../cpu/spinlock.h"
 
 void memcpy(void* source, void *dest, uint32_t nbytes) {
     int i;
@@ -36,12 +37,13 @@ heap_meta* findNextFree(heap_meta* ptr, size_t nsize)
 {	
 	if (ptr->next == 0x0) return ptr;
 	
-	if (ptr->size == 0 && (void*)ptr->next - (void*)ptr > nsize + sizeof(heap_meta)) return ptr;	
+	//the split needs room for this block and the header of the leftover
+	if (ptr->size == 0 && (void*)ptr->next - (void*)ptr >= nsize + 2 * sizeof(heap_meta)) return ptr;	
 	
 	return findNextFree(ptr->next, nsize);
 }
 
-void* kmalloc(size_t size)
+static void* heap_alloc(size_t size)
 {	
 	if (size == 0) return 0x0;
 
@@ -55,15 +57,17 @@ void* kmalloc(size_t size)
 	free_mem_addr->next = newNext;
 	
 	newNext->next = oldNext;
-	newNext->prev = (void*)(free_mem_addr) + sizeof(heap_meta);
+	newNext->prev = free_mem_addr;
+	newNext->size = 0;
+	if (oldNext != 0x0) oldNext->prev = newNext;
 	
 	heap_size += size + sizeof(heap_meta);
-	memset(free_mem_addr+sizeof(heap_meta), 0, size); //clean up leftovers
+	memset((void*)(free_mem_addr) + sizeof(heap_meta), 0, size); //clean up leftovers
 	
     return (void*)(free_mem_addr) + sizeof(heap_meta);
 }
 
-void kfree(void* ptr)
+static void heap_free(void* ptr)
 {
 	if (ptr == 0x0) return;
 
@@ -77,9 +81,7 @@ void kfree(void* ptr)
 	meta->size = 0;
 	
 	heap_meta* next = meta->next;
-	heap_meta* prev = meta->prev;
-	
-	if (next->size == 0)
+	if (next != 0x0 && next->size == 0)
 	{
 		meta->next = next->next;
 		
@@ -87,19 +89,22 @@ void kfree(void* ptr)
 		next->prev = 0x0;
 	}
 	
-	if (prev->size == 0)
+	heap_meta* prev = meta->prev;
+	if (prev != 0x0 && prev->size == 0)
 	{
-		next->prev = prev;
 		prev->next = meta->next;
 		
 		meta->next = 0x0;
 		meta->prev = 0x0;
+		meta = prev;
 	}
 	
+	if (meta->next != 0x0) meta->next->prev = meta;
+	
 	heap_size -= (freedSize + sizeof(heap_meta));	
 }
 
-void* krealloc(void* ptr, size_t size)
+static void* heap_realloc(void* ptr, size_t size)
 {
 	if (ptr == 0x0) return 0x0;
 
@@ -108,6 +113,7 @@ void* krealloc(void* ptr, size_t size)
 	size_t curSize = meta->size;
 	if (size < curSize)
 	{
+		heap_size -= curSize - size;
 		meta->size = size;
 		return ptr;
 	}
@@ -119,25 +125,54 @@ void* krealloc(void* ptr, size_t size)
 		next = next->next;
 	}
 	
-	if (next == 0x0 || (void*)next - (void*)ptr > size)
+	if (next == 0x0 || (void*)next - (void*)ptr >= size + sizeof(heap_meta))
 	{
+		heap_size += size - curSize;
 		meta->size = size;
-		meta->next = (heap_meta*)((void*)(meta->next) + size - curSize);
+		memset(ptr + curSize, 0, size - curSize); //may hold old data or free headers, kmalloc memory is zeroed
+		meta->next = (heap_meta*)(ptr + size);
 		
+		meta->next->size = 0;
 		meta->next->next = next;
 		meta->next->prev = meta;
+		if (next != 0x0) next->prev = meta->next;
 		return ptr;
 	}
 	
-	void* newp = kmalloc(size);
-	memcpy(ptr, newp, size);
-	kfree(ptr);
+	void* newp = heap_alloc(size);
+	memcpy(ptr, newp, curSize);
+	heap_free(ptr);
 	return newp;	
 }
 
+//threads and the other cpus share the heap, every call holds heap_lock with interrupts disabled
+static spinlock heap_lock = SPINLOCK_INIT;
+
+void* kmalloc(size_t size)
+{
+	uint32_t flags = spin_lock_irqsave(&heap_lock);
+	void* ptr = heap_alloc(size);
+	spin_unlock_irqrestore(&heap_lock, flags);
+	return ptr;
+}
+
+void kfree(void* ptr)
+{
+	uint32_t flags = spin_lock_irqsave(&heap_lock);
+	heap_free(ptr);
+	spin_unlock_irqrestore(&heap_lock, flags);
+}
+
+void* krealloc(void* ptr, size_t size)
+{
+	uint32_t flags = spin_lock_irqsave(&heap_lock);
+	void* newp = heap_realloc(ptr, size);
+	spin_unlock_irqrestore(&heap_lock, flags);
+	return newp;
+}
+
 
 #ifdef HEAP_DEBUG
-#include "string.h"
 #include "../drivers/screen.h"
 void dump_blocks(heap_meta* block)
 {
@@ -146,31 +181,19 @@ void dump_blocks(heap_meta* block)
 	heap_meta* prev = block->prev;
 	
 	kprint_color(GREEN_TEXT);
-	char sizestr[16] = "";
-	int_to_ascii(size, sizestr);
-	kprint(sizestr);
-	kprint(" ");
+	kprintf("%u ", size);
 	
 	kprint_color(RED_TEXT);
-	char nextstr[16] = "";
-	hex_to_ascii((uint32_t)next, nextstr);
-	kprint(nextstr);
-	kprint(" ");
+	kprintf("0x%x ", (uint32_t)next);
 	
 	kprint_color(BLUE_TEXT);
-	char prevstr[16] = "";
-	hex_to_ascii((uint32_t)prev, prevstr);
-	kprint(prevstr);
-	kprint(" ");
+	kprintf("0x%x ", (uint32_t)prev);
 	
 	/*
 	kprint_color(GRAY_TEXT);
 	for (size_t i = 0; i < size + 12; i++)
 	{
-		char hexstr[16] = "";
-		hex_to_ascii(*(char*)(block+i), hexstr);
-		kprint(hexstr);
-		kprint(" ");
+		kprintf("0x%x ", *(uint8_t*)(block+i));
 	}
 	*/
 	
@@ -180,11 +203,7 @@ void dump_blocks(heap_meta* block)
 void dump_heap()
 {
 	//clear_screen();
-	char hsize[16] = "";
-	int_to_ascii(heap_size, hsize);
-	kprint("Heap size: ");
-	kprint(hsize);
-	kprint(" bytes \n");
+	kprintf("Heap size: %u bytes \n", heap_size);
 	dump_blocks(heap_begin);
 }
 #endif
@@ -0,0 +1,175 @@
+#include "printf.h"
+
+typedef struct {
+    char *buf;
+    uint32_t size;
+    uint32_t len; /* keeps counting past size */
+} fmt_out;
+
+/* arguments come from a va_list or from an array of words (kwsnprintf) */
+typedef struct {
+    va_list *va;
+    uint32_t *words;
+    int count;
+} fmt_args;
+
+static uint32_t arg32(fmt_args *a) {
+    if (a->va) return va_arg(*a->va, uint32_t);
+    if (a->count <= 0) return 0;
+    a->count--;
+    return *a->words++;
+}
+
+static uint64_t arg64(fmt_args *a) {
+    if (a->va) return va_arg(*a->va, uint64_t);
+    uint64_t low = arg32(a);
+    return low | (uint64_t)arg32(a) << 32;
+}
+
+static void put(fmt_out *out, char c) {
+    if (out->len + 1 < out->size) out->buf[out->len] = c;
+    out->len++;
+}
+
+static void put_padded(fmt_out *out, char *s, int len, int width, char pad, int left) {
+    int i;
+    /* a '-' has to stay in front of zero padding */
+    if (pad == '0' && *s == '-') {
+        put(out, '-');
+        s++;
+        len--;
+        width--;
+    }
+    if (!left) for (i = len; i < width; i++) put(out, pad);
+    for (i = 0; i < len; i++) put(out, s[i]);
+    if (left) for (i = len; i < width; i++) put(out, ' ');
+}
+
+/* digits are produced backwards at the end of tmp, returns the first one.
+ * 32 bit values divide by a constant (a multiply), 64 bit ones are split
+ * into 16 bit steps like uint64_to_ascii since there is no __udivdi3 */
+static char *utoa(uint64_t n, int base, int upper, char *end) {
+    char *digits = upper ? "0123456789ABCDEF" : "0123456789abcdef";
+    char *p = end;
+    if (base == 16) {
+        do {
+            *--p = digits[n & 0xF];
+            n >>= 4;
+        } while (n != 0);
+        return p;
+    }
+
+    uint32_t high = n >> 32, low = (uint32_t)n;
+    while (high != 0) {
+        uint32_t rem = high % 10;
+        high /= 10;
+        uint32_t mid = (rem << 16) | (low >> 16);
+        rem = mid % 10;
+        uint32_t bottom = (rem << 16) | (low & 0xFFFF);
+        low = ((mid / 10) << 16) | (bottom / 10);
+        *--p = '0' + bottom % 10;
+    }
+    do {
+        *--p = '0' + low % 10;
+        low /= 10;
+    } while (low != 0);
+    return p;
+}
+
+static int format(char *buf, uint32_t size, char *fmt, fmt_args *args) {
+    fmt_out out = { buf, size, 0 };
+    char tmp[24];
+
+    while (*fmt != '\0') {
+        if (*fmt != '%') {
+            put(&out, *fmt++);
+            continue;
+        }
+        fmt++;
+
+        int left = 0;
+        char pad = ' ';
+        for (;; fmt++) {
+            if (*fmt == '-') left = 1;
+            else if (*fmt == '0') pad = '0';
+            else break;
+        }
+        if (left) pad = ' ';
+
+        int width = 0;
+        while (*fmt >= '0' && *fmt <= '9') width = width * 10 + (*fmt++ - '0');
+
+        int wide = 0;
+        while (*fmt == 'l') {
+            wide++;
+            fmt++;
+        }
+
+        char *end = tmp + sizeof(tmp);
+        char *s;
+        switch (*fmt) {
+            case 'd': {
+                int64_t v = wide >= 2 ? (int64_t)arg64(args) : (int32_t)arg32(args);
+                s = utoa(v < 0 ? -(uint64_t)v : (uint64_t)v, 10, 0, end);
+                if (v < 0) *--s = '-';
+                put_padded(&out, s, end - s, width, pad, left);
+                break;
+            }
+            case 'u':
+            case 'x':
+            case 'X': {
+                uint64_t v = wide >= 2 ? arg64(args) : arg32(args);
+                s = utoa(v, *fmt == 'u' ? 10 : 16, *fmt == 'X', end);
+                put_padded(&out, s, end - s, width, pad, left);
+                break;
+            }
+            case 's': {
+                s = args->va ? va_arg(*args->va, char*) : (char*)arg32(args);
+                if (s == 0x0) s = "(null)";
+                int len = 0;
+                while (s[len] != '\0') len++;
+                put_padded(&out, s, len, width, ' ', left);
+                break;
+            }
+            case 'c':
+                tmp[0] = (char)arg32(args);
+                put_padded(&out, tmp, 1, width, ' ', left);
+                break;
+            case '%':
+                put(&out, '%');
+                break;
+            case '\0':
+                fmt--; /* a lone '%' at the end */
+                break;
+            default: /* unknown conversions are printed as they are */
+                put(&out, '%');
+                put(&out, *fmt);
+        }
+        fmt++;
+    }
+
+    if (size != 0) buf[out.len < size ? out.len : size - 1] = '\0';
+    return out.len;
+}
+
+int kvsnprintf(char *buf, uint32_t size, char *fmt, va_list args) {
+    va_list va;
+    va_copy(va, args);
+    fmt_args a = { &va, 0x0, 0 };
+    int len = format(buf, size, fmt, &a);
+    va_end(va);
+    return len;
+}
+
+int kwsnprintf(char *buf, uint32_t size, char *fmt, uint32_t *words, int count) {
+    fmt_args a = { 0x0, words, count };
+    return format(buf, size, fmt, &a);
+}
+
+int ksnprintf(char *buf, uint32_t size, char *fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    int len = kvsnprintf(buf, size, fmt, args);
+    va_end(args);
+    return len;
+}
@@ -0,0 +1,19 @@
+#ifndef PRINTF_H
+#define PRINTF_H
+
+#include <stdint.h>
+#include <stdarg.h>
+
+/* Formatting without the FPU or libgcc
+ * %d %u %x %X %s %c %%, an 'll' prefix makes d/u/x 64 bit.
+ * flags: '-' pads on the right, '0' pads numbers with zeros, then a width.
+ * The output is always terminated and cut at size, the return value is the
+ * full length like snprintf so callers can tell it was cut. */
+int kvsnprintf(char *buf, uint32_t size, char *fmt, va_list args);
+int ksnprintf(char *buf, uint32_t size, char *fmt, ...);
+
+/* same, but the arguments are count 32 bit words (64 bit values take two, low first).
+ * used to format saved arguments later, missing arguments read as 0 */
+int kwsnprintf(char *buf, uint32_t size, char *fmt, uint32_t *words, int count);
+
+#endif
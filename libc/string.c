@@ -1,8 +1,6 @@
 #include "string.h"
 #include <stdint.h>
 
-#include "math.h"
-
 void int_to_ascii(int n, char str[]) {
     int i, sign;
     if ((sign = n) < 0) n = -n;
@@ -17,6 +15,24 @@ void int_to_ascii(int n, char str[]) {
     reverse(str);
 }
 
+/* 64 bit values are divided in 16 bit steps, there is no libgcc for __udivdi3 */
+void uint64_to_ascii(uint64_t n, char str[]) {
+    uint32_t high = n >> 32, low = (uint32_t)n;
+    int i = 0;
+    do {
+        uint32_t rem = high % 10;
+        high /= 10;
+        uint32_t mid = (rem << 16) | (low >> 16);
+        rem = mid % 10;
+        uint32_t bottom = (rem << 16) | (low & 0xFFFF);
+        low = ((mid / 10) << 16) | (bottom / 10);
+        str[i++] = bottom % 10 + '0';
+    } while (high != 0 || low != 0);
+    str[i] = '\0';
+
+    reverse(str);
+}
+
 void hex_to_ascii(int n, char str[]) {
     append(str, '0');
     append(str, 'x');
@@ -28,7 +44,7 @@ void hex_to_ascii(int n, char str[]) {
         tmp = (n >> i) & 0xF;
         if (tmp == 0 && zeros == 0) continue;
         zeros = 1;
-        if (tmp > 0xA) append(str, tmp - 0xA + 'a');
+        if (tmp >= 0xA) append(str, tmp - 0xA + 'a');
         else append(str, tmp + '0');
     }
 
@@ -84,6 +100,7 @@ void strcpy(char src[], char* dst)
 	}
 }
 
+//parses the leading decimal digits, stops at the first other character
 int stoi(char s[])
 {
 	unsigned int i = 0;
@@ -94,13 +111,10 @@ int stoi(char s[])
 		i++;
 	}
 	
-	int len = strlen(s);
 	int opt = 0;
-	int fig = pow(10, len - 1);
-	while (s[i] != '\0')
+	while (s[i] >= '0' && s[i] <= '9')
 	{
-		opt += (s[i++] - 48) * fig;
-		fig *= 0.1;
+		opt = opt * 10 + (s[i++] - '0');
 	}
 	return opt * sign;
 }
@@ -0,0 +1,17 @@
+/* hello, a user program for the run command (kernel/elf.h)
+ *
+ * linked at the start of the user window with page aligned segments, make fs-image puts it in the image:
+ *     > run hello.elf
+ * there is no libc for programs, they talk to the kernel through the syscall.h wrappers.
+ */
+#include "../kernel/syscall.h"
+
+static char greeting[] = "Hello from ring 3!\n";
+static uint32_t counter; //bss, a zeroed page of its own
+
+void _start()
+{
+	counter += user_syscall(SYS_THREAD, 0, 0, 0);
+	user_syscall(SYS_WRITE, (uint32_t)greeting, sizeof(greeting) - 1, 0);
+	user_syscall(SYS_EXIT, counter, 0, 0);
+}
@@ -0,0 +1,594 @@
+/* jfsutil, host side tool for JFS images
+ *
+ * jfsutil mkfs <image> [-w width] [-d depth] [-f files] [-s filesize] [-l namelen] [-n maxnodes] [-S imagesize] -b lba [-z 1] [-a script] [-p file]...
+ *     builds a synthetic tree: every folder above depth gets 'width' sub folders and 'files' files
+ *     generation is breadth first and stops once the node limit or the table is full
+ *     -z 1 stores the files packed (compressed, see jfs.h)
+ *     -a copies a host file to /autorun, the kernel runs it as a shell script at boot (kernel/shell.h)
+ *     -p copies a host file to root under its own name (programs for the run command, tools/hello.c), repeatable
+ * jfsutil fsck <image> -b lba
+ *     validates the table and file extents (decompressing packed files), prints table utilization
+ * jfsutil dump <image> -b lba
+ *     fsck plus a listing of the tree
+ *
+ * an image starts with the JFS table, it is what vdrive.bin holds in os-image.bin.
+ * -b is the absolute lba the image is placed at (kernel_end), file lbas in the table are absolute.
+ * it depends on the size of the kernel, so there is no default (the Makefile passes FS_LBA).
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "../kernel/jfs.h"
+#include "../libc/lz.c"
+
+#define MAX_DEPTH FS_MAX_NODES
+#define MAX_NAME 200
+#define MAX_HOST_FILES 8 //-p
+
+typedef struct gnode {
+	uint8_t type;
+	char name[MAX_NAME + 1];
+	uint32_t size; //files
+	uint32_t lba;
+	uint32_t sectors;
+	uint8_t* packed; //extent contents of a packed file
+	uint8_t* data; //contents of a file copied from the host, 0x0 for generated text
+	struct gnode** children;
+	uint32_t childCnt;
+} gnode;
+
+typedef struct {
+	uint32_t base;
+	uint32_t width, depth, files, filesize, namelen, maxnodes, imagesize, pack;
+	const char* script;
+	const char* hostfiles[MAX_HOST_FILES];
+	uint32_t hostcount;
+} options;
+
+static void usage()
+{
+	fprintf(stderr,
+		"usage: jfsutil mkfs <image> [-w width] [-d depth] [-f files] [-s filesize] [-l namelen] [-n maxnodes] [-S imagesize] -b lba [-z 1] [-a script] [-p file]...\n"
+		"       jfsutil fsck <image> -b lba\n"
+		"       jfsutil dump <image> -b lba\n");
+	exit(2);
+}
+
+static uint32_t put16(uint8_t* p, uint16_t v) { p[0] = v; p[1] = v >> 8; return 2; }
+static uint32_t put32(uint8_t* p, uint32_t v) { p[0] = v; p[1] = v >> 8; p[2] = v >> 16; p[3] = v >> 24; return 4; }
+static uint16_t get16(const uint8_t* p) { return p[0] | p[1] << 8; }
+static uint32_t get32(const uint8_t* p) { return p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24; }
+
+//bitwise CRC32C, matches libc/crc32.c
+static uint32_t crc32c(const uint8_t* p, uint32_t len)
+{
+	uint32_t crc = ~0u;
+	while (len--)
+	{
+		crc ^= *p++;
+		for (int k = 0; k < 8; k++) crc = (crc & 1) ? (crc >> 1) ^ 0x82F63B78 : crc >> 1;
+	}
+	return ~crc;
+}
+
+static uint32_t sector_len(uint32_t i)
+{
+	return i == FS_TABLE_SECTORS - 1 ? FS_SECTOR_SIZE - FS_TRAILER_SIZE : FS_SECTOR_SIZE;
+}
+
+static void seal_table(uint8_t* table)
+{
+	put32(table + FS_TABLE_DATA, FS_TABLE_MAGIC);
+	for (uint32_t i = 0; i < FS_TABLE_SECTORS; i++)
+		put32(table + FS_TABLE_DATA + 4 + i * 4, crc32c(table + i * FS_SECTOR_SIZE, sector_len(i)));
+}
+
+/* mkfs */
+
+static void make_name(char* dst, char kind, uint32_t id, uint32_t len)
+{
+	int n = snprintf(dst, MAX_NAME + 1, "%c%u", kind, id);
+	while ((uint32_t)n < len && n < MAX_NAME) dst[n++] = '_';
+	dst[n] = '\0';
+}
+
+static gnode* new_node(uint8_t type, char kind, uint32_t id, uint32_t namelen)
+{
+	gnode* n = calloc(1, sizeof(gnode));
+	n->type = type;
+	make_name(n->name, kind, id, namelen);
+	return n;
+}
+
+static void add_child(gnode* parent, gnode* child, uint32_t cap)
+{
+	if (parent->children == NULL) parent->children = calloc(cap, sizeof(gnode*));
+	parent->children[parent->childCnt++] = child;
+}
+
+//bytes the record of a node takes in the table, plus its offset slot in the parent
+static uint32_t record_size(gnode* n, uint32_t children, int pack)
+{
+	uint32_t nlen = strlen(n->name) + 1;
+	if (n->type == FS_FOLDER) return FS_FOLDER_HEADER + nlen + children * 2 + 2;
+	return (pack ? FS_PACKED_HEADER : FS_FILE_HEADER) + nlen + 2;
+}
+
+//-a and -p files, they come first in root
+static gnode* load_host(const char* path, const char* name)
+{
+	FILE* f = fopen(path, "rb");
+	if (f == NULL) { perror(path); exit(1); }
+	fseek(f, 0, SEEK_END);
+	long size = ftell(f);
+	fseek(f, 0, SEEK_SET);
+
+	gnode* n = calloc(1, sizeof(gnode));
+	n->type = FS_FILE;
+	snprintf(n->name, sizeof(n->name), "%s", name);
+	n->size = size;
+	n->data = malloc(size + 1);
+	if (fread(n->data, 1, size, f) != (size_t)size) { perror(path); exit(1); }
+	fclose(f);
+	return n;
+}
+
+static gnode* generate(options* o, uint32_t* nodes, uint32_t* used)
+{
+	uint32_t extra = o->hostcount + (o->script != NULL);
+	uint32_t perfolder = o->width + o->files;
+	if (perfolder > FS_MAX_CHILDREN - extra) perfolder = FS_MAX_CHILDREN - extra; //room for the host files in root
+
+	gnode* root = new_node(FS_FOLDER, 'r', 0, 0);
+	*nodes = 0;
+	*used = FS_ROOT_HEADER;
+
+	for (uint32_t i = 0; i < extra; i++)
+	{
+		const char* path = o->script;
+		const char* name = "autorun";
+		if (o->script == NULL || i > 0)
+		{
+			path = o->hostfiles[i - (o->script != NULL)];
+			name = strrchr(path, '/') != NULL ? strrchr(path, '/') + 1 : path;
+		}
+
+		gnode* file = load_host(path, name);
+		add_child(root, file, perfolder + extra);
+		*used += record_size(file, 0, o->pack);
+		(*nodes)++;
+	}
+
+	//breadth first so a truncated tree stays balanced
+	uint32_t qcap = 1024, qhead = 0, qtail = 0;
+	gnode** queue = malloc(qcap * sizeof(gnode*));
+	uint32_t* depths = malloc(qcap * sizeof(uint32_t));
+	queue[qtail] = root;
+	depths[qtail++] = 0;
+
+	uint32_t id = 0;
+	int full = 0;
+	while (qhead < qtail && !full)
+	{
+		gnode* folder = queue[qhead];
+		uint32_t depth = depths[qhead++];
+
+		for (uint32_t i = 0; i < perfolder; i++)
+		{
+			int isfolder = i < o->width;
+			if (isfolder && depth >= o->depth) continue;
+
+			gnode* child = new_node(isfolder ? FS_FOLDER : FS_FILE, isfolder ? 'd' : 'f', id++, o->namelen);
+			if (!isfolder) child->size = o->filesize;
+
+			uint32_t rs = record_size(child, 0, o->pack && !isfolder);
+			if (*nodes >= o->maxnodes || *used + rs > FS_TABLE_DATA)
+			{
+				free(child);
+				full = 1;
+				break;
+			}
+			*used += rs;
+			(*nodes)++;
+			add_child(folder, child, perfolder);
+
+			if (isfolder)
+			{
+				if (qtail == qcap)
+				{
+					qcap *= 2;
+					queue = realloc(queue, qcap * sizeof(gnode*));
+					depths = realloc(depths, qcap * sizeof(uint32_t));
+				}
+				queue[qtail] = child;
+				depths[qtail++] = depth + 1;
+			}
+		}
+	}
+	free(queue);
+	free(depths);
+	return root;
+}
+
+//same pre-order layout as save_node in filesystem.c
+static uint32_t serialize(gnode* n, uint8_t* buf)
+{
+	buf[0] = n->type;
+	uint32_t nlen = strlen(n->name) + 1;
+
+	if (n->type == FS_FILE)
+	{
+		uint32_t header = n->packed ? FS_PACKED_HEADER : FS_FILE_HEADER;
+		if (n->packed) buf[0] |= FS_PACKED;
+		put32(buf + 1, n->lba);
+		put32(buf + 5, n->size);
+		if (n->packed) put32(buf + 9, n->sectors);
+		memcpy(buf + header, n->name, nlen);
+		return header + nlen;
+	}
+
+	buf[1] = n->childCnt;
+	memcpy(buf + FS_FOLDER_HEADER, n->name, nlen);
+	uint32_t coff = FS_FOLDER_HEADER + nlen + n->childCnt * 2;
+	for (uint32_t i = 0; i < n->childCnt; i++)
+	{
+		put16(buf + FS_FOLDER_HEADER + nlen + i * 2, coff);
+		coff += serialize(n->children[i], buf + coff);
+	}
+	return coff;
+}
+
+static void file_text(gnode* c, uint8_t* data)
+{
+	if (c->data != NULL)
+	{
+		memcpy(data, c->data, c->size);
+		return;
+	}
+
+	uint32_t pos = 0;
+	uint32_t line = 0;
+	while (pos < c->size)
+	{
+		char text[64];
+		int len = snprintf(text, sizeof(text), "%s line %u\n", c->name, line++);
+		for (int j = 0; j < len && pos < c->size; j++) data[pos++] = text[j];
+	}
+}
+
+//same layout as pack_file in filesystem.c, returns the extent and its size in sectors
+static uint8_t* pack(gnode* c, uint32_t* sectors)
+{
+	uint32_t pages = (c->size + FS_PAGE_SIZE - 1) / FS_PAGE_SIZE;
+	uint32_t dirsectors = fs_pack_dir_sectors(pages);
+	uint8_t* text = calloc(pages, FS_PAGE_SIZE);
+	uint8_t* ext = calloc(dirsectors + pages * FS_PAGE_SECTORS, FS_SECTOR_SIZE);
+	file_text(c, text);
+
+	put16(ext, pages);
+	uint32_t pos = dirsectors * FS_SECTOR_SIZE;
+	for (uint32_t i = 0; i < pages; i++)
+	{
+		uint32_t len = lz_compress(text + i * FS_PAGE_SIZE, FS_PAGE_SIZE, ext + pos, FS_PAGE_SIZE - FS_SECTOR_SIZE);
+		if (len == 0)
+		{
+			memcpy(ext + pos, text + i * FS_PAGE_SIZE, FS_PAGE_SIZE);
+			len = FS_PAGE_SIZE;
+		}
+		put16(ext + 2 + i * 2, len);
+		pos += fs_pack_sectors(len) * FS_SECTOR_SIZE;
+	}
+	free(text);
+	*sectors = pos / FS_SECTOR_SIZE;
+	return ext;
+}
+
+static void place_files(gnode* n, uint32_t* next_lba, uint32_t* files, int packed)
+{
+	for (uint32_t i = 0; i < n->childCnt; i++)
+	{
+		gnode* c = n->children[i];
+		if (c->type == FS_FOLDER)
+		{
+			place_files(c, next_lba, files, packed);
+		}
+		else if (c->size != 0)
+		{
+			c->lba = *next_lba;
+			c->sectors = fs_cap_pages(c->size) * FS_PAGE_SECTORS;
+			if (packed && (c->size + FS_PAGE_SIZE - 1) / FS_PAGE_SIZE <= FS_PACK_MAX_PAGES) c->packed = pack(c, &c->sectors);
+			*next_lba += c->sectors;
+			(*files)++;
+		}
+	}
+}
+
+static void fill_files(gnode* n, uint8_t* image, uint32_t base)
+{
+	for (uint32_t i = 0; i < n->childCnt; i++)
+	{
+		gnode* c = n->children[i];
+		if (c->type == FS_FOLDER)
+		{
+			fill_files(c, image, base);
+			continue;
+		}
+
+		uint8_t* data = image + (c->lba - base) * FS_SECTOR_SIZE;
+		if (c->packed) memcpy(data, c->packed, c->sectors * FS_SECTOR_SIZE);
+		else file_text(c, data);
+	}
+}
+
+static int do_mkfs(const char* path, options* o)
+{
+	uint32_t nodes, used;
+	gnode* root = generate(o, &nodes, &used);
+
+	uint32_t next_lba = o->base + FS_TABLE_SECTORS;
+	uint32_t files = 0;
+	place_files(root, &next_lba, &files, o->pack);
+
+	uint32_t needed = (next_lba - o->base) * FS_SECTOR_SIZE;
+	uint32_t size = needed > o->imagesize ? needed : o->imagesize;
+	uint8_t* image = calloc(1, size);
+
+	//root has no name or type on disk, only the child count and offsets
+	image[0] = root->childCnt;
+	uint32_t coff = FS_ROOT_HEADER + root->childCnt * 2;
+	for (uint32_t i = 0; i < root->childCnt; i++)
+	{
+		put16(image + FS_ROOT_HEADER + i * 2, coff);
+		coff += serialize(root->children[i], image + coff);
+	}
+	fill_files(root, image, o->base);
+	seal_table(image);
+
+	FILE* f = fopen(path, "wb");
+	if (f == NULL || fwrite(image, 1, size, f) != size)
+	{
+		perror(path);
+		return 1;
+	}
+	fclose(f);
+
+	printf("mkfs %s nodes=%u files=%u table=%u/%u (%u%%) data_sectors=%u image=%u\n",
+		path, nodes, files, coff, FS_TABLE_DATA, coff * 100 / FS_TABLE_DATA,
+		next_lba - o->base - FS_TABLE_SECTORS, size);
+	return 0;
+}
+
+/* fsck and dump */
+
+typedef struct {
+	const uint8_t* image;
+	uint32_t size;
+	uint32_t base;
+	int dump;
+	uint32_t errors, folders, files, packed, maxdepth, tableused, datasectors, datasize;
+	uint32_t (*extents)[2];
+	uint32_t extentCnt, extentCap;
+} checker;
+
+static void report(checker* c, uint32_t off, const char* msg)
+{
+	printf("error: node at table offset %u: %s\n", off, msg);
+	c->errors++;
+}
+
+//returns the name length including the terminator, 0 if it runs off the table
+static uint32_t name_len(checker* c, uint32_t off)
+{
+	for (uint32_t i = off; i < FS_TABLE_DATA; i++)
+	{
+		if (c->image[i] == '\0') return i - off + 1;
+	}
+	return 0;
+}
+
+//walks the page directory of a packed file and decompresses every page
+static void check_packed(checker* c, uint32_t off, uint32_t lba, uint32_t size, uint32_t sectors)
+{
+	const uint8_t* ext = c->image + (lba - c->base) * FS_SECTOR_SIZE;
+	uint32_t pages = get16(ext);
+	if (pages != (size + FS_PAGE_SIZE - 1) / FS_PAGE_SIZE || pages > FS_PACK_MAX_PAGES)
+	{
+		report(c, off, "packed page count doesn't match the file size");
+		return;
+	}
+
+	uint32_t pos = fs_pack_dir_sectors(pages);
+	if (pos > sectors) { report(c, off, "packed directory runs past the extent"); return; }
+
+	uint8_t page[FS_PAGE_SIZE];
+	for (uint32_t i = 0; i < pages; i++)
+	{
+		uint32_t len = get16(ext + 2 + i * 2);
+		if (len == 0 || len > FS_PAGE_SIZE || pos + fs_pack_sectors(len) > sectors)
+		{
+			report(c, off, "packed page runs past the extent");
+			return;
+		}
+		if (len < FS_PAGE_SIZE && lz_decompress((uint8_t*)ext + pos * FS_SECTOR_SIZE, len, page, FS_PAGE_SIZE) != FS_PAGE_SIZE)
+			report(c, off, "packed page doesn't decompress");
+		pos += fs_pack_sectors(len);
+	}
+	if (pos != sectors) report(c, off, "packed extent size doesn't match its pages");
+}
+
+static void check_node(checker* c, uint32_t off, uint32_t depth)
+{
+	if (depth > MAX_DEPTH) { report(c, off, "tree too deep"); return; }
+	if (off >= FS_TABLE_DATA) { report(c, off, "offset outside the table"); return; }
+	if (depth > c->maxdepth) c->maxdepth = depth;
+
+	const uint8_t* t = c->image;
+	uint8_t type = t[off] & FS_TYPE_MASK;
+	uint8_t packed = type == FS_FILE && (t[off] & FS_PACKED);
+	uint32_t header = type == FS_FOLDER ? FS_FOLDER_HEADER : (packed ? FS_PACKED_HEADER : FS_FILE_HEADER);
+	if (type != FS_FOLDER && type != FS_FILE) { report(c, off, "unknown node type"); return; }
+	if (off + header >= FS_TABLE_DATA) { report(c, off, "header runs off the table"); return; }
+
+	uint32_t nlen = name_len(c, off + header);
+	if (nlen == 0) { report(c, off, "unterminated name"); return; }
+	const char* name = (const char*)t + off + header;
+
+	if (type == FS_FILE)
+	{
+		uint32_t lba = get32(t + off + 1);
+		uint32_t size = get32(t + off + 5);
+		uint32_t sectors = packed ? get32(t + off + 9) : fs_cap_pages(size) * FS_PAGE_SECTORS;
+		c->files++;
+		c->packed += packed;
+		c->datasize += size;
+		if (off + header + nlen > c->tableused) c->tableused = off + header + nlen;
+
+		if (c->dump && packed)
+			printf("%*s%s  (%u bytes, lba %u, %u sectors, packed %u%%)\n", depth * 2, "", name, size, lba, sectors,
+				size ? (uint32_t)((uint64_t)sectors * FS_SECTOR_SIZE * 100 / size) : 0);
+		else if (c->dump) printf("%*s%s  (%u bytes, lba %u, %u sectors)\n", depth * 2, "", name, size, lba, sectors);
+
+		if (sectors == 0) return;
+		if (lba < c->base + FS_TABLE_SECTORS) { report(c, off, "file data overlaps the table"); return; }
+		if ((uint64_t)(lba - c->base + sectors) * FS_SECTOR_SIZE > c->size) { report(c, off, "file data past the end of the image"); return; }
+		if (packed) check_packed(c, off, lba, size, sectors);
+		if (c->extentCnt < c->extentCap)
+		{
+			c->extents[c->extentCnt][0] = lba;
+			c->extents[c->extentCnt++][1] = sectors;
+		}
+		c->datasectors += sectors;
+		return;
+	}
+
+	uint8_t children = t[off + 1];
+	uint32_t offsets = off + header + nlen;
+	c->folders++;
+	if (offsets + children * 2 > FS_TABLE_DATA) { report(c, off, "child offsets run off the table"); return; }
+	if (offsets + children * 2 > c->tableused) c->tableused = offsets + children * 2;
+
+	if (c->dump) printf("%*s%s/\n", depth * 2, "", name);
+
+	for (uint32_t i = 0; i < children; i++)
+	{
+		uint16_t coff = get16(t + offsets + i * 2);
+		if (coff < header + nlen + children * 2) { report(c, off, "child offset points into its parent"); continue; }
+		check_node(c, off + coff, depth + 1);
+	}
+}
+
+static int cmp_extent(const void* a, const void* b)
+{
+	uint32_t x = ((const uint32_t*)a)[0], y = ((const uint32_t*)b)[0];
+	return x < y ? -1 : x > y;
+}
+
+static int do_check(const char* path, options* o, int dump)
+{
+	FILE* f = fopen(path, "rb");
+	if (f == NULL) { perror(path); return 1; }
+	fseek(f, 0, SEEK_END);
+	long size = ftell(f);
+	fseek(f, 0, SEEK_SET);
+	if (size < FS_TABLE_SIZE)
+	{
+		fprintf(stderr, "%s: smaller than the %u byte table\n", path, FS_TABLE_SIZE);
+		return 1;
+	}
+	uint8_t* image = malloc(size);
+	if (fread(image, 1, size, f) != (size_t)size) { perror(path); return 1; }
+	fclose(f);
+
+	checker c = { 0 };
+	c.image = image;
+	c.size = size;
+	c.base = o->base;
+	c.dump = dump;
+	c.extentCap = FS_TABLE_DATA / FS_FILE_HEADER + 1;
+	c.extents = malloc(sizeof(uint32_t[2]) * c.extentCap);
+
+	if (get32(image + FS_TABLE_DATA) == FS_TABLE_MAGIC)
+	{
+		for (uint32_t i = 0; i < FS_TABLE_SECTORS; i++)
+		{
+			if (get32(image + FS_TABLE_DATA + 4 + i * 4) != crc32c(image + i * FS_SECTOR_SIZE, sector_len(i)))
+			{
+				printf("error: checksum mismatch in table sector %u\n", i);
+				c.errors++;
+			}
+		}
+	}
+	else if (dump) printf("table has no checksums\n");
+
+	uint8_t children = image[0];
+	c.tableused = FS_ROOT_HEADER + children * 2;
+	if (dump) printf("/\n");
+	for (uint32_t i = 0; i < children; i++)
+	{
+		uint16_t coff = get16(image + FS_ROOT_HEADER + i * 2);
+		if (coff < c.tableused) { report(&c, 0, "child offset points into root"); continue; }
+		check_node(&c, coff, 1);
+	}
+
+	qsort(c.extents, c.extentCnt, sizeof(uint32_t[2]), cmp_extent);
+	for (uint32_t i = 1; i < c.extentCnt; i++)
+	{
+		if (c.extents[i - 1][0] + c.extents[i - 1][1] > c.extents[i][0])
+		{
+			printf("error: file extents at lba %u and %u overlap\n", c.extents[i - 1][0], c.extents[i][0]);
+			c.errors++;
+		}
+	}
+
+	uint32_t nodes = c.folders + c.files;
+	printf("fsck %s nodes=%u folders=%u files=%u packed=%u depth=%u table=%u/%u (%u%%) data=%u data_sectors=%u errors=%u\n",
+		path, nodes, c.folders, c.files, c.packed, c.maxdepth, c.tableused, FS_TABLE_DATA,
+		c.tableused * 100 / FS_TABLE_DATA, c.datasize, c.datasectors, c.errors);
+	if (nodes + 1 > FS_MAX_NODES) printf("warning: the kernel only holds %u nodes\n", FS_MAX_NODES);
+	return c.errors ? 1 : 0;
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 3) usage();
+
+	options o = { 0, 4, 3, 2, 0, 0, FS_MAX_NODES - 1, 512 * 1024, 0, NULL, { NULL }, 0 };
+	for (int i = 3; i < argc; i++)
+	{
+		if (argv[i][0] != '-' || argv[i][2] != '\0' || i + 1 >= argc) usage();
+		if (argv[i][1] == 'a')
+		{
+			o.script = argv[++i];
+			continue;
+		}
+		if (argv[i][1] == 'p')
+		{
+			if (o.hostcount == MAX_HOST_FILES) usage();
+			o.hostfiles[o.hostcount++] = argv[++i];
+			continue;
+		}
+		uint32_t v = strtoul(argv[++i], NULL, 0);
+		switch (argv[i - 1][1])
+		{
+			case 'b': o.base = v; break;
+			case 'w': o.width = v; break;
+			case 'd': o.depth = v; break;
+			case 'f': o.files = v; break;
+			case 's': o.filesize = v; break;
+			case 'l': o.namelen = v > MAX_NAME ? MAX_NAME : v; break;
+			case 'n': o.maxnodes = v; break;
+			case 'S': o.imagesize = v; break;
+			case 'z': o.pack = v; break;
+			default: usage();
+		}
+	}
+	if (o.base == 0) usage(); //lba 0 is the boot sector
+
+	if (strcmp(argv[1], "mkfs") == 0) return do_mkfs(argv[2], &o);
+	if (strcmp(argv[1], "fsck") == 0) return do_check(argv[2], &o, 0);
+	if (strcmp(argv[1], "dump") == 0) return do_check(argv[2], &o, 1);
+	usage();
+	return 2;
+}
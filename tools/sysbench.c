@@ -0,0 +1,63 @@
+/* sysbench, round trip cycles of both system call paths, the syscall shell command runs it
+ *
+ * SYS_THREAD does next to nothing in the kernel, so the cycles are what crossing into ring 0 and back costs:
+ * int 0x80 through the interrupt gate and isr_handler, SYSENTER through sysenter_entry (kernel/syscall.h).
+ */
+#include "../kernel/syscall.h"
+#include "../cpu/cpuid.h"
+#include "../cpu/timer.h"
+
+static char line[64];
+static uint32_t len;
+
+static void put(char* s)
+{
+	while (*s != '\0' && len < sizeof(line)) line[len++] = *s++;
+}
+
+static void put_uint(uint32_t n)
+{
+	char digits[10];
+	int i = 0;
+	do
+	{
+		digits[i++] = '0' + n % 10;
+		n /= 10;
+	} while (n != 0);
+	while (i > 0 && len < sizeof(line)) line[len++] = digits[--i];
+}
+
+static void report(char* path, uint64_t cycles)
+{
+	len = 0;
+	put("syscall ");
+	put(path);
+	put(" calls=");
+	put_uint(SYSCALL_BENCH_CALLS);
+	put(" cycles=");
+	put_uint(div64_32(cycles, SYSCALL_BENCH_CALLS));
+	put("\n");
+	user_syscall(SYS_WRITE, (uint32_t)line, len, 0);
+}
+
+void _start()
+{
+	uint64_t start = rdtsc();
+	for (uint32_t i = 0; i < SYSCALL_BENCH_CALLS; i++) user_syscall(SYS_THREAD, 0, 0, 0);
+	report("int80", rdtsc() - start);
+
+	if (cpu_sysenter())
+	{
+		start = rdtsc();
+		for (uint32_t i = 0; i < SYSCALL_BENCH_CALLS; i++) user_sysenter(SYS_THREAD, 0, 0, 0);
+		report("sysenter", rdtsc() - start);
+	}
+	else
+	{
+		len = 0;
+		put("syscall sysenter unsupported\n");
+		user_syscall(SYS_WRITE, (uint32_t)line, len, 0);
+	}
+
+	user_syscall(SYS_EXIT, 0, 0, 0);
+}
@@ -1,3 +1,3 @@
 [bits 32]
 
-times 32768 - ($-$$) db 0
+times 524288 - ($-$$) db 0